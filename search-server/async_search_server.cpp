@@ -0,0 +1,13 @@
+#include "async_search_server.h"
+
+using namespace std;
+
+AsyncSearchServer::AsyncSearchServer(const SearchServer& search_server, WorkStealingPool& pool, bool parallel_scan)
+        : search_server_(search_server)
+        , pool_(pool)
+        , parallel_scan_(parallel_scan) {
+}
+
+future<vector<Document>> AsyncSearchServer::SubmitFind(string raw_query) {
+    return SubmitFind(move(raw_query), DocumentStatusSet(DocumentStatus::ACTUAL));
+}
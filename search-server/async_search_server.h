@@ -0,0 +1,85 @@
+#pragma once
+
+#include "search_server.h"
+#include "work_stealing_pool.h"
+
+#include <exception>
+#include <future>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Асинхронный поиск на общем пуле потоков: медленный запрос не задерживает ответы на те,
+// что поставлены после него. Индекс не должен меняться, пока есть незавершённые запросы.
+class AsyncSearchServer {
+public:
+    // При parallel_scan списки вхождений одного запроса обходятся шардами на том же пуле.
+    AsyncSearchServer(const SearchServer& search_server, WorkStealingPool& pool, bool parallel_scan = false);
+
+    // Ждёт места в очереди пула. Если истёк options.deadline, future содержит DeadlineExceeded.
+    template <typename DocumentPredicate>
+    std::future<std::vector<Document>> SubmitFind(std::string raw_query, DocumentPredicate document_predicate,
+                                                  const TopKOptions& options = {});
+    std::future<std::vector<Document>> SubmitFind(std::string raw_query);
+
+    // Не ждёт: при полной очереди возвращает false, и on_complete не вызывается. Иначе
+    // on_complete(documents, error) вызывается в потоке пула; при успехе error пуст.
+    template <typename DocumentPredicate, typename Callback>
+    bool TrySubmitFind(std::string raw_query, DocumentPredicate document_predicate, const TopKOptions& options,
+                       Callback on_complete);
+
+private:
+    template <typename DocumentPredicate>
+    std::vector<Document> Find(const std::string& raw_query, DocumentPredicate document_predicate,
+                               const TopKOptions& options) const;
+
+    const SearchServer& search_server_;
+    WorkStealingPool& pool_;
+    bool parallel_scan_;
+};
+
+template <typename DocumentPredicate>
+std::future<std::vector<Document>> AsyncSearchServer::SubmitFind(std::string raw_query, DocumentPredicate document_predicate,
+                                                                 const TopKOptions& options) {
+    // std::function требует копируемой задачи, а promise только перемещается.
+    auto promise = std::make_shared<std::promise<std::vector<Document>>>();
+    std::future<std::vector<Document>> result = promise->get_future();
+    pool_.Submit([this, promise, raw_query = std::move(raw_query), document_predicate, options] {
+        try {
+            promise->set_value(Find(raw_query, document_predicate, options));
+        } catch (...) {
+            promise->set_exception(std::current_exception());
+        }
+    });
+    return result;
+}
+
+template <typename DocumentPredicate, typename Callback>
+bool AsyncSearchServer::TrySubmitFind(std::string raw_query, DocumentPredicate document_predicate, const TopKOptions& options,
+                                      Callback on_complete) {
+    return pool_.TrySubmit([this, raw_query = std::move(raw_query), document_predicate, options, on_complete] {
+        std::vector<Document> documents;
+        std::exception_ptr error;
+        try {
+            documents = Find(raw_query, document_predicate, options);
+        } catch (...) {
+            error = std::current_exception();
+        }
+        on_complete(std::move(documents), error);
+    });
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> AsyncSearchServer::Find(const std::string& raw_query, DocumentPredicate document_predicate,
+                                              const TopKOptions& options) const {
+    if (!parallel_scan_) {
+        return search_server_.FindTopDocuments(std::execution::seq, raw_query, document_predicate, options);
+    }
+    const auto run_shards = [this](int shard_count, const auto& job) {
+        pool_.ParallelFor(static_cast<size_t>(shard_count), [&job](size_t shard_index) {
+            job(static_cast<int>(shard_index));
+        });
+    };
+    return search_server_.FindTopDocumentsSharded(run_shards, raw_query, document_predicate, options);
+}
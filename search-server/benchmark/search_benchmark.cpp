@@ -0,0 +1,415 @@
+#include "async_search_server.h"
+#include "search_server.h"
+#include "sharded_search_server.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+using namespace std;
+
+// Синтетический бенчмарк горячих путей SearchServer. Каждая строка вывода — отдельный
+// JSON-объект, чтобы результаты можно было сравнивать между коммитами скриптом.
+//
+//   search_benchmark [--docs N] [--vocab N] [--zipf S] [--doc-len N] [--queries N] [--seed N] [--shards N]
+//
+// С --shards N выдача ShardedSearchServer из N шардов в этом же процессе и в дочерних процессах
+// сравнивается с выдачей одного SearchServer; при расхождении бенчмарк завершается с кодом 1.
+
+namespace {
+
+struct BenchmarkConfig {
+    int document_count = 100000;
+    int vocabulary_size = 50000;
+    double zipf_skew = 1.0;
+    int document_length = 50;
+    int query_count = 2000;
+    uint32_t seed = 42;
+    size_t shard_count = 0;
+};
+
+BenchmarkConfig ParseArguments(int argc, char** argv) {
+    BenchmarkConfig config;
+    for (int i = 1; i < argc; ++i) {
+        const string_view name = argv[i];
+        if (i + 1 == argc) {
+            throw invalid_argument("missing value for "s + string(name));
+        }
+        const string value = argv[++i];
+        if (name == "--docs") {
+            config.document_count = stoi(value);
+        } else if (name == "--vocab") {
+            config.vocabulary_size = stoi(value);
+        } else if (name == "--zipf") {
+            config.zipf_skew = stod(value);
+        } else if (name == "--doc-len") {
+            config.document_length = stoi(value);
+        } else if (name == "--queries") {
+            config.query_count = stoi(value);
+        } else if (name == "--seed") {
+            config.seed = static_cast<uint32_t>(stoul(value));
+        } else if (name == "--shards") {
+            config.shard_count = stoul(value);
+        } else {
+            throw invalid_argument("unknown option "s + string(name));
+        }
+    }
+    return config;
+}
+
+TopKOptions MakeOptions(size_t count, TopKMode mode, QueryMatch match = QueryMatch::ANY,
+                        RankingModel ranking = RankingModel::TF_IDF) {
+    TopKOptions options;
+    options.count = count;
+    options.mode = mode;
+    options.match = match;
+    options.ranking = ranking;
+    return options;
+}
+
+// Слово ранга r выбирается с вероятностью, пропорциональной 1 / r^skew.
+class ZipfWordGenerator {
+public:
+    ZipfWordGenerator(int vocabulary_size, double skew) {
+        cumulative_weights_.reserve(vocabulary_size);
+        double total = 0.0;
+        for (int rank = 1; rank <= vocabulary_size; ++rank) {
+            total += 1.0 / pow(rank, skew);
+            cumulative_weights_.push_back(total);
+        }
+    }
+
+    string operator()(mt19937& generator) const {
+        uniform_real_distribution<double> distribution(0.0, cumulative_weights_.back());
+        const double point = distribution(generator);
+        const auto rank = lower_bound(cumulative_weights_.begin(), cumulative_weights_.end(), point) - cumulative_weights_.begin();
+        return "w"s + to_string(rank);
+    }
+
+private:
+    vector<double> cumulative_weights_;
+};
+
+string GenerateText(const ZipfWordGenerator& words, mt19937& generator, int word_count) {
+    string text;
+    for (int i = 0; i < word_count; ++i) {
+        if (i > 0) {
+            text += ' ';
+        }
+        text += words(generator);
+    }
+    return text;
+}
+
+vector<string> GenerateQueries(const ZipfWordGenerator& words, mt19937& generator, int query_count,
+                               int plus_word_count, int minus_word_count) {
+    vector<string> queries;
+    queries.reserve(query_count);
+    for (int i = 0; i < query_count; ++i) {
+        string query = GenerateText(words, generator, plus_word_count);
+        for (int j = 0; j < minus_word_count; ++j) {
+            query += " -"s + words(generator);
+        }
+        queries.push_back(move(query));
+    }
+    return queries;
+}
+
+double ElapsedSeconds(chrono::steady_clock::time_point start) {
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+double Percentile(vector<double> values, double fraction) {
+    if (values.empty()) {
+        return 0.0;
+    }
+    const size_t pos = min(values.size() - 1, static_cast<size_t>(fraction * values.size()));
+    nth_element(values.begin(), values.begin() + pos, values.end());
+    return values[pos];
+}
+
+// Короткие запросы вперемешку с длинными (каждый четвёртый) через AsyncSearchServer, не больше
+// двух запросов на поток одновременно. Задержка коротких считается от постановки до вызова
+// обработчика; длинные ограничены сроком.
+void BenchmarkAsyncMixed(const SearchServer& search_server, const string& name, const vector<string>& short_queries,
+                         const vector<string>& long_queries, bool parallel_scan, chrono::microseconds long_deadline) {
+    WorkStealingPool pool;
+    AsyncSearchServer async_server(search_server, pool, parallel_scan);
+    const DocumentStatusSet actual(DocumentStatus::ACTUAL);
+    vector<double> latencies(short_queries.size());
+    atomic<size_t> completed{0};
+    atomic<size_t> expired{0};
+    size_t submitted = 0;
+    const size_t max_in_flight = pool.GetThreadCount() * 2;
+    const auto submit = [&](const string& query, const TopKOptions& options, auto on_complete) {
+        while (submitted - completed.load() >= max_in_flight
+               || !async_server.TrySubmitFind(query, actual, options, on_complete)) {
+            this_thread::yield();
+        }
+        ++submitted;
+    };
+    const auto start = chrono::steady_clock::now();
+    for (size_t i = 0; i < short_queries.size(); ++i) {
+        const auto submit_time = chrono::steady_clock::now();
+        submit(short_queries[i], TopKOptions{}, [&, i, submit_time](vector<Document>, exception_ptr) {
+            latencies[i] = ElapsedSeconds(submit_time) * 1e6;
+            ++completed;
+        });
+        if (i % 4 == 0) {
+            TopKOptions options;
+            options.deadline = chrono::steady_clock::now() + long_deadline;
+            submit(long_queries[i % long_queries.size()], options, [&](vector<Document>, exception_ptr error) {
+                if (error) {
+                    ++expired;
+                }
+                ++completed;
+            });
+        }
+    }
+    while (completed.load() < submitted) {
+        this_thread::yield();
+    }
+    cout << "{\"benchmark\": \"async_find\", \"case\": \"" << name << "\""
+         << ", \"threads\": " << pool.GetThreadCount()
+         << ", \"queries\": " << submitted
+         << ", \"seconds\": " << ElapsedSeconds(start)
+         << ", \"short_p50_us\": " << Percentile(latencies, 0.5)
+         << ", \"short_p99_us\": " << Percentile(latencies, 0.99)
+         << ", \"long_expired\": " << expired.load() << "}\n";
+}
+
+bool HaveSameDocuments(const vector<Document>& lhs, const vector<Document>& rhs) {
+    return equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(), [](const Document& lhs, const Document& rhs) {
+        return lhs.id == rhs.id && lhs.relevance == rhs.relevance && lhs.rating == rhs.rating;
+    });
+}
+
+// Выдача шардированного сервера должна совпадать с выдачей одного сервера до бита релевантности.
+// Возвращает число расхождений; задержка замеряется на запросах с параметрами по умолчанию.
+size_t BenchmarkSharded(const SearchServer& search_server, ShardedSearchServer& sharded_server, const string& placement,
+                        const vector<vector<string>>& query_sets) {
+    const vector<TopKOptions> option_cases = {
+        {},
+        MakeOptions(MAX_RESULT_DOCUMENT_COUNT, TopKMode::WAND),
+        MakeOptions(MAX_RESULT_DOCUMENT_COUNT, TopKMode::EXHAUSTIVE, QueryMatch::ALL),
+        MakeOptions(MAX_RESULT_DOCUMENT_COUNT, TopKMode::EXHAUSTIVE, QueryMatch::ANY, RankingModel::BM25),
+        MakeOptions(100, TopKMode::WAND, QueryMatch::ANY, RankingModel::BM25),
+    };
+    const vector<DocumentStatusSet> status_cases = {DocumentStatusSet(DocumentStatus::ACTUAL), DocumentStatusSet::All()};
+    vector<double> latencies;
+    size_t query_count = 0;
+    size_t mismatch_count = 0;
+    for (const vector<string>& queries : query_sets) {
+        for (const TopKOptions& options : option_cases) {
+            for (const DocumentStatusSet statuses : status_cases) {
+                for (const string& query : queries) {
+                    const auto start = chrono::steady_clock::now();
+                    const vector<Document> documents = sharded_server.FindTopDocuments(query, statuses, options);
+                    if (&options == &option_cases.front()) {
+                        latencies.push_back(ElapsedSeconds(start) * 1e6);
+                    }
+                    ++query_count;
+                    if (!HaveSameDocuments(documents, search_server.FindTopDocuments(execution::seq, query, statuses, options))) {
+                        ++mismatch_count;
+                    }
+                }
+            }
+        }
+    }
+    cout << "{\"benchmark\": \"sharded_find\", \"placement\": \"" << placement << "\""
+         << ", \"shards\": " << sharded_server.GetShardCount()
+         << ", \"queries\": " << query_count
+         << ", \"p50_us\": " << Percentile(latencies, 0.5)
+         << ", \"p99_us\": " << Percentile(latencies, 0.99)
+         << ", \"mismatches\": " << mismatch_count << "}\n";
+    return mismatch_count;
+}
+
+long GetPeakMemoryKilobytes() {
+#ifndef _WIN32
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+#else
+    return 0;
+#endif
+}
+
+template <typename ExecutionPolicy, typename DocumentPredicate>
+void BenchmarkFind(const SearchServer& search_server, const string& name, const vector<string>& queries, ExecutionPolicy policy,
+                   DocumentPredicate document_predicate, const TopKOptions& options = {}) {
+    SearchInstrumentation::Reset();
+    vector<double> latencies;
+    latencies.reserve(queries.size());
+    size_t result_count = 0;
+    for (const string& query : queries) {
+        const auto start = chrono::steady_clock::now();
+        result_count += search_server.FindTopDocuments(policy, query, document_predicate, options).size();
+        latencies.push_back(ElapsedSeconds(start) * 1e6);
+    }
+    cout << "{\"benchmark\": \"find_top_documents\", \"case\": \"" << name << "\""
+         << ", \"queries\": " << queries.size()
+         << ", \"p50_us\": " << Percentile(latencies, 0.5)
+         << ", \"p99_us\": " << Percentile(latencies, 0.99)
+         << ", \"results\": " << result_count << "}\n";
+    if constexpr (INSTRUMENTATION_ENABLED) {
+        cout << SearchInstrumentation::GetSnapshot() << "\n";
+    }
+}
+
+template <typename ExecutionPolicy>
+void BenchmarkFind(const SearchServer& search_server, const string& name, const vector<string>& queries, ExecutionPolicy policy,
+                   const TopKOptions& options = {}) {
+    const auto is_actual = [](int, DocumentStatus status, int) {
+        return status == DocumentStatus::ACTUAL;
+    };
+    BenchmarkFind(search_server, name, queries, policy, is_actual, options);
+}
+
+}
+
+int main(int argc, char** argv) {
+    try {
+        const BenchmarkConfig config = ParseArguments(argc, argv);
+        // Процессы шардов порождаются fork, поэтому до первого параллельного алгоритма.
+        optional<ShardedSearchServer> process_sharded_server;
+        if (config.shard_count > 0) {
+            process_sharded_server.emplace("w0 w1 w2"s, config.shard_count, ShardPlacement::SEPARATE_PROCESS);
+        }
+        mt19937 generator(config.seed);
+        const ZipfWordGenerator words(config.vocabulary_size, config.zipf_skew);
+
+        vector<string> texts;
+        texts.reserve(config.document_count);
+        size_t total_words = 0;
+        for (int i = 0; i < config.document_count; ++i) {
+            texts.push_back(GenerateText(words, generator, config.document_length));
+            total_words += config.document_length;
+        }
+
+        SearchServer search_server("w0 w1 w2"s);
+        const auto add_start = chrono::steady_clock::now();
+        for (int i = 0; i < config.document_count; ++i) {
+            search_server.AddDocument(i, texts[i], static_cast<DocumentStatus>(i % 4), {i % 10, 5});
+        }
+        const double add_seconds = ElapsedSeconds(add_start);
+        cout << "{\"benchmark\": \"add_document\", \"documents\": " << config.document_count
+             << ", \"vocabulary\": " << config.vocabulary_size
+             << ", \"zipf\": " << config.zipf_skew
+             << ", \"document_length\": " << config.document_length
+             << ", \"seconds\": " << add_seconds
+             << ", \"documents_per_sec\": " << config.document_count / add_seconds
+             << ", \"words_per_sec\": " << total_words / add_seconds << "}\n";
+        search_server.CompactIndex();
+
+        {
+            vector<RawDocument> batch;
+            batch.reserve(config.document_count);
+            for (int i = 0; i < config.document_count; ++i) {
+                batch.push_back({i, texts[i], static_cast<DocumentStatus>(i % 4), {i % 10, 5}});
+            }
+            SearchServer bulk_server("w0 w1 w2"s);
+            const auto bulk_start = chrono::steady_clock::now();
+            bulk_server.AddDocuments(batch);
+            const double bulk_seconds = ElapsedSeconds(bulk_start);
+            cout << "{\"benchmark\": \"add_documents\", \"documents\": " << config.document_count
+                 << ", \"seconds\": " << bulk_seconds
+                 << ", \"documents_per_sec\": " << config.document_count / bulk_seconds << "}\n";
+        }
+
+        const vector<string> short_queries = GenerateQueries(words, generator, config.query_count, 2, 0);
+        const vector<string> long_queries = GenerateQueries(words, generator, config.query_count, 10, 0);
+        const vector<string> short_minus_queries = GenerateQueries(words, generator, config.query_count, 2, 1);
+        const vector<string> long_minus_queries = GenerateQueries(words, generator, config.query_count, 10, 3);
+
+        BenchmarkFind(search_server, "short", short_queries, execution::seq);
+        BenchmarkFind(search_server, "long", long_queries, execution::seq);
+        BenchmarkFind(search_server, "short_minus", short_minus_queries, execution::seq);
+        BenchmarkFind(search_server, "long_minus", long_minus_queries, execution::seq);
+        BenchmarkFind(search_server, "long_par", long_queries, execution::par);
+        BenchmarkFind(search_server, "short_all", short_queries, execution::seq,
+                      MakeOptions(MAX_RESULT_DOCUMENT_COUNT, TopKMode::EXHAUSTIVE, QueryMatch::ALL));
+        BenchmarkFind(search_server, "short_bm25", short_queries, execution::seq,
+                      MakeOptions(MAX_RESULT_DOCUMENT_COUNT, TopKMode::EXHAUSTIVE, QueryMatch::ANY, RankingModel::BM25));
+
+        {
+            // Корпус, где ACTUAL лишь каждый 20-й документ, а остальные BANNED или REMOVED:
+            // фильтр по статусу предикатом и набором статусов.
+            vector<RawDocument> batch;
+            batch.reserve(config.document_count);
+            for (int i = 0; i < config.document_count; ++i) {
+                const DocumentStatus status = i % 20 == 0 ? DocumentStatus::ACTUAL
+                                            : i % 2 == 0 ? DocumentStatus::BANNED : DocumentStatus::REMOVED;
+                batch.push_back({i, texts[i], status, {i % 10, 5}});
+            }
+            SearchServer skewed_server("w0 w1 w2"s);
+            skewed_server.AddDocuments(batch);
+            BenchmarkFind(skewed_server, "skewed_predicate", short_queries, execution::seq);
+            BenchmarkFind(skewed_server, "skewed_status_set", short_queries, execution::seq, DocumentStatusSet(DocumentStatus::ACTUAL));
+            BenchmarkFind(skewed_server, "skewed_status_set_wand", short_queries, execution::seq, DocumentStatusSet(DocumentStatus::ACTUAL),
+                          MakeOptions(MAX_RESULT_DOCUMENT_COUNT, TopKMode::WAND));
+        }
+
+        BenchmarkAsyncMixed(search_server, "mixed", short_queries, long_queries, false, chrono::milliseconds(5));
+        BenchmarkAsyncMixed(search_server, "mixed_parallel_scan", short_queries, long_queries, true, chrono::milliseconds(5));
+
+        const auto match_start = chrono::steady_clock::now();
+        size_t matched_words = 0;
+        for (size_t i = 0; i < long_minus_queries.size(); ++i) {
+            const int document_id = static_cast<int>(i % config.document_count);
+            matched_words += get<0>(search_server.MatchDocument(long_minus_queries[i], document_id)).size();
+        }
+        const double match_seconds = ElapsedSeconds(match_start);
+        cout << "{\"benchmark\": \"match_document\", \"queries\": " << long_minus_queries.size()
+             << ", \"matches_per_sec\": " << long_minus_queries.size() / match_seconds
+             << ", \"matched_words\": " << matched_words << "}\n";
+
+        cout << "{\"benchmark\": \"memory\", \"peak_rss_kb\": " << GetPeakMemoryKilobytes()
+             << ", \"index_bytes\": " << search_server.GetIndexMemoryUsage() << "}\n";
+
+        if (process_sharded_server) {
+            vector<RawDocument> batch;
+            batch.reserve(config.document_count);
+            for (int i = 0; i < config.document_count; ++i) {
+                batch.push_back({i, texts[i], static_cast<DocumentStatus>(i % 4), {i % 10, 5}});
+            }
+            ShardedSearchServer local_sharded_server("w0 w1 w2"s, config.shard_count);
+            local_sharded_server.AddDocuments(batch);
+            process_sharded_server->AddDocuments(batch);
+            const vector<vector<string>> query_sets = {short_queries, long_minus_queries};
+            size_t mismatch_count = BenchmarkSharded(search_server, local_sharded_server, "in_process", query_sets)
+                                  + BenchmarkSharded(search_server, *process_sharded_server, "separate_process", query_sets);
+            // Удаление меняет документные частоты, которые шарды получают от сервера.
+            for (int i = 0; i < config.document_count; i += 7) {
+                search_server.RemoveDocument(i);
+                local_sharded_server.RemoveDocument(i);
+                process_sharded_server->RemoveDocument(i);
+            }
+            mismatch_count += BenchmarkSharded(search_server, local_sharded_server, "in_process_after_remove", query_sets)
+                            + BenchmarkSharded(search_server, *process_sharded_server, "separate_process_after_remove", query_sets);
+            if (mismatch_count > 0) {
+                cerr << "Sharded results differ from a single server in " << mismatch_count << " queries\n";
+                return 1;
+            }
+        }
+    } catch (const exception& e) {
+        cerr << "Benchmark error: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
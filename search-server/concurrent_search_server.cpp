@@ -0,0 +1,38 @@
+#include "concurrent_search_server.h"
+
+using namespace std;
+
+ConcurrentSearchServer::ConcurrentSearchServer(SearchServer search_server)
+        : search_server_(move(search_server)) {
+}
+
+void ConcurrentSearchServer::AddDocument(int document_id, string_view document, DocumentStatus status, const vector<int>& ratings) {
+    const PreparedDocument prepared = search_server_.PrepareDocument(document_id, document, status, ratings);
+    lock_guard lock(mutex_);
+    search_server_.AddPreparedDocument(prepared);
+}
+
+void ConcurrentSearchServer::RemoveDocument(int document_id) {
+    lock_guard lock(mutex_);
+    search_server_.RemoveDocument(document_id);
+}
+
+vector<Document> ConcurrentSearchServer::FindTopDocuments(string_view raw_query, DocumentStatus status) const {
+    shared_lock lock(mutex_);
+    return search_server_.FindTopDocuments(raw_query, status);
+}
+
+vector<Document> ConcurrentSearchServer::FindTopDocuments(string_view raw_query) const {
+    shared_lock lock(mutex_);
+    return search_server_.FindTopDocuments(raw_query);
+}
+
+tuple<vector<string_view>, DocumentStatus> ConcurrentSearchServer::MatchDocument(string_view raw_query, int document_id) const {
+    shared_lock lock(mutex_);
+    return search_server_.MatchDocument(raw_query, document_id);
+}
+
+int ConcurrentSearchServer::GetDocumentCount() const {
+    shared_lock lock(mutex_);
+    return search_server_.GetDocumentCount();
+}
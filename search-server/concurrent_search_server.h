@@ -0,0 +1,50 @@
+#pragma once
+
+#include "search_server.h"
+
+#include <mutex>
+#include <shared_mutex>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+// Обёртка над SearchServer для одновременного добавления документов и поиска.
+// Разбор текста документа идёт без блокировки, под исключительной блокировкой
+// выполняется только запись в индекс. Запрос целиком выполняется под разделяемой
+// блокировкой, поэтому видит согласованное состояние индекса и одно число документов.
+class ConcurrentSearchServer {
+public:
+    explicit ConcurrentSearchServer(SearchServer search_server);
+
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+    void RemoveDocument(int document_id);
+
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate) const;
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status) const;
+    std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
+
+    std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(std::string_view raw_query, int document_id) const;
+
+    int GetDocumentCount() const;
+
+    // Вызывает function(const SearchServer&) под разделяемой блокировкой.
+    template <typename Function>
+    auto Read(Function function) const;
+
+private:
+    mutable std::shared_mutex mutex_;
+    SearchServer search_server_;
+};
+
+template <typename DocumentPredicate>
+std::vector<Document> ConcurrentSearchServer::FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate) const {
+    std::shared_lock lock(mutex_);
+    return search_server_.FindTopDocuments(raw_query, document_predicate);
+}
+
+template <typename Function>
+auto ConcurrentSearchServer::Read(Function function) const {
+    std::shared_lock lock(mutex_);
+    return function(static_cast<const SearchServer&>(search_server_));
+}
@@ -1,10 +1,15 @@
 #include "document.h"
 
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
 using namespace std;
 
 Document::Document(int id, double relevance, int rating)
-        : id(id)
-        , relevance(relevance)
+        : relevance(relevance)
+        , id(id)
         , rating(rating) {
     }
 
@@ -12,3 +17,31 @@ ostream& operator<<(ostream& output, const Document& doc){
     output << "{ document_id = " << doc.id << ", relevance = " << doc.relevance << ", rating = " << doc.rating << " }";
     return output;
     }
+
+bool CompareDocuments(const Document& lhs, const Document& rhs) {
+    if (std::abs(lhs.relevance - rhs.relevance) < numeric_limits<double>::epsilon()) {
+        if (lhs.rating == rhs.rating) {
+            return lhs.id < rhs.id;
+        }
+        return lhs.rating > rhs.rating;
+    }
+    return lhs.relevance > rhs.relevance;
+}
+
+DocumentStatus ParseDocumentStatus(string_view name) {
+    if (name == "ACTUAL") return DocumentStatus::ACTUAL;
+    if (name == "IRRELEVANT") return DocumentStatus::IRRELEVANT;
+    if (name == "BANNED") return DocumentStatus::BANNED;
+    if (name == "REMOVED") return DocumentStatus::REMOVED;
+    throw invalid_argument("Invalid status: " + string(name));
+}
+
+string_view GetDocumentStatusName(DocumentStatus status) {
+    switch (status) {
+        case DocumentStatus::ACTUAL: return "ACTUAL";
+        case DocumentStatus::IRRELEVANT: return "IRRELEVANT";
+        case DocumentStatus::BANNED: return "BANNED";
+        case DocumentStatus::REMOVED: return "REMOVED";
+    }
+    return "UNKNOWN";
+}
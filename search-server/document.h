@@ -1,14 +1,17 @@
 #pragma once
 
+#include <cstdint>
 #include <iostream>
+#include <string_view>
 
 struct Document {
     Document() = default;
 
     Document(int id, double relevance, int rating);
 
-    int id = 0;
+    // relevance идёт первым, чтобы структура занимала 16 байт без выравнивающих дыр.
     double relevance = 0.0;
+    int id = 0;
     int rating = 0;
 };
 
@@ -19,5 +22,60 @@ enum class DocumentStatus {
     REMOVED,
 };
 
+// Разбирает имя статуса (ACTUAL, IRRELEVANT, BANNED, REMOVED); иначе invalid_argument.
+DocumentStatus ParseDocumentStatus(std::string_view name);
+
+std::string_view GetDocumentStatusName(DocumentStatus status);
+
+const int DOCUMENT_STATUS_COUNT = 4;
+
+// Набор статусов в виде битовой маски. Передаётся в FindTopDocuments вместо предиката:
+// SearchServer проверяет его по битовым картам статусов, не читая данные документа.
+// Как предикат годится и для остальных мест, где ожидается предикат документа.
+class DocumentStatusSet {
+public:
+    constexpr DocumentStatusSet() = default;
+
+    constexpr explicit DocumentStatusSet(DocumentStatus status)
+        : mask_(GetBit(status)) {
+    }
+
+    static constexpr DocumentStatusSet All() {
+        DocumentStatusSet statuses;
+        statuses.mask_ = (1u << DOCUMENT_STATUS_COUNT) - 1;
+        return statuses;
+    }
+
+    constexpr void Add(DocumentStatus status) {
+        mask_ |= GetBit(status);
+    }
+
+    constexpr bool Contains(DocumentStatus status) const {
+        return (mask_ & GetBit(status)) != 0;
+    }
+
+    constexpr bool IsEmpty() const {
+        return mask_ == 0;
+    }
+
+    constexpr uint8_t GetMask() const {
+        return mask_;
+    }
+
+    constexpr bool operator()(int, DocumentStatus status, int) const {
+        return Contains(status);
+    }
+
+private:
+    static constexpr uint8_t GetBit(DocumentStatus status) {
+        return static_cast<uint8_t>(1u << static_cast<int>(status));
+    }
+
+    uint8_t mask_ = 0;
+};
+
 std::ostream& operator<<(std::ostream& output, const Document& doc);
+
+// Порядок выдачи: по убыванию релевантности (с точностью до epsilon), затем рейтинга, затем по возрастанию id.
+bool CompareDocuments(const Document& lhs, const Document& rhs);
     
@@ -0,0 +1,389 @@
+#include "inverted_index.h"
+
+#include <algorithm>
+
+using namespace std;
+
+namespace {
+
+uint8_t BitWidth(uint32_t value) {
+    uint8_t bits = 0;
+    while (value != 0) {
+        ++bits;
+        value >>= 1;
+    }
+    return bits;
+}
+
+size_t PackedWords(size_t count, uint8_t bits) {
+    return (count * bits + 31) / 32;
+}
+
+void PackBits(const uint32_t* values, size_t count, uint8_t bits, vector<uint32_t>& packed) {
+    const size_t first_word = packed.size();
+    // Одно слово запаса, чтобы запись и чтение шли по два соседних слова без проверки границ.
+    packed.resize(first_word + PackedWords(count, bits) + 1, 0);
+    if (bits == 0) {
+        return;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        const size_t bit = i * bits;
+        const uint64_t shifted = static_cast<uint64_t>(values[i]) << (bit % 32);
+        packed[first_word + bit / 32] |= static_cast<uint32_t>(shifted);
+        packed[first_word + bit / 32 + 1] |= static_cast<uint32_t>(shifted >> 32);
+    }
+}
+
+// Цикл без ветвлений по фиксированной ширине, который компилятор векторизует.
+void UnpackBits(const uint32_t* packed, size_t count, uint8_t bits, uint32_t* values) {
+    if (bits == 0) {
+        fill(values, values + count, 0);
+        return;
+    }
+    const uint64_t mask = (uint64_t{1} << bits) - 1;
+    for (size_t i = 0; i < count; ++i) {
+        const size_t bit = i * bits;
+        const uint64_t window = packed[bit / 32] | (static_cast<uint64_t>(packed[bit / 32 + 1]) << 32);
+        values[i] = static_cast<uint32_t>((window >> (bit % 32)) & mask);
+    }
+}
+
+}  // namespace
+
+size_t PostingList::size() const {
+    return size_;
+}
+
+bool PostingList::empty() const {
+    return size_ == 0;
+}
+
+double PostingList::GetMaxTermFreq() const {
+    return max_term_freq_;
+}
+
+void PostingList::Append(int document_index, uint32_t freq_code) {
+    if (tail_documents_.empty() && !blocks_.empty() && blocks_.back().size < BLOCK_SIZE) {
+        UnsealLastBlock();
+    }
+    if (tail_documents_.size() == BLOCK_SIZE) {
+        SealTail();
+    }
+    tail_documents_.push_back(document_index);
+    tail_freq_codes_.push_back(freq_code);
+    ++size_;
+}
+
+void PostingList::SealTail() {
+    PostingBlock& block = blocks_.emplace_back();
+    EncodeBlock(tail_documents_.data(), tail_freq_codes_.data(), tail_documents_.size(), block, packed_);
+    tail_documents_.clear();
+    tail_freq_codes_.clear();
+}
+
+void PostingList::UnsealLastBlock() {
+    const PostingBlock block = blocks_.back();
+    tail_documents_.resize(block.size);
+    tail_freq_codes_.resize(block.size);
+    DecodeDocuments(block, tail_documents_.data());
+    DecodeFreqCodes(block, tail_freq_codes_.data());
+    blocks_.pop_back();
+    packed_.resize(block.offset);
+}
+
+void PostingList::Compact() {
+    if (!tail_documents_.empty()) {
+        SealTail();
+    }
+    blocks_.shrink_to_fit();
+    packed_.shrink_to_fit();
+    tail_documents_.shrink_to_fit();
+    tail_freq_codes_.shrink_to_fit();
+}
+
+// Индексы хранятся как first_document и разности соседних индексов минус один,
+// так что подряд идущие документы занимают ноль бит.
+void PostingList::EncodeBlock(const int* documents, const uint32_t* freq_codes, size_t size, PostingBlock& block,
+                              vector<uint32_t>& packed) const {
+    array<uint32_t, BLOCK_SIZE> gaps;
+    gaps[0] = 0;
+    uint32_t max_gap = 0;
+    uint32_t max_freq_code = 0;
+    for (size_t i = 0; i < size; ++i) {
+        if (i > 0) {
+            gaps[i] = static_cast<uint32_t>(documents[i] - documents[i - 1] - 1);
+            max_gap = max(max_gap, gaps[i]);
+        }
+        max_freq_code = max(max_freq_code, freq_codes[i]);
+    }
+
+    block.first_document = documents[0];
+    block.last_document = documents[size - 1];
+    block.offset = static_cast<uint32_t>(packed.size());
+    block.size = static_cast<uint16_t>(size);
+    block.document_bits = BitWidth(max_gap);
+    block.freq_bits = BitWidth(max_freq_code);
+    PackBits(gaps.data(), size, block.document_bits, packed);
+    packed.pop_back();
+    PackBits(freq_codes, size, block.freq_bits, packed);
+}
+
+void PostingList::DecodeDocuments(const PostingBlock& block, int* documents) const {
+    array<uint32_t, BLOCK_SIZE> gaps;
+    UnpackBits(packed_.data() + block.offset, block.size, block.document_bits, gaps.data());
+    int document = block.first_document;
+    documents[0] = document;
+    for (size_t i = 1; i < block.size; ++i) {
+        document += static_cast<int>(gaps[i]) + 1;
+        documents[i] = document;
+    }
+}
+
+void PostingList::DecodeFreqCodes(const PostingBlock& block, uint32_t* freq_codes) const {
+    UnpackBits(packed_.data() + block.offset + PackedWords(block.size, block.document_bits), block.size, block.freq_bits, freq_codes);
+}
+
+PostingCursor::PostingCursor(const PostingList& postings, const vector<double>& term_freq_values)
+        : postings_(&postings)
+        , term_freq_values_(&term_freq_values) {
+    LoadBlock(0);
+}
+
+bool PostingCursor::AtEnd() const {
+    return pos_ >= block_size_;
+}
+
+int PostingCursor::GetDocument() const {
+    return documents_[pos_];
+}
+
+double PostingCursor::GetTermFreq() const {
+    if (!freq_codes_loaded_) {
+        if (block_index_ < postings_->blocks_.size()) {
+            postings_->DecodeFreqCodes(postings_->blocks_[block_index_], freq_codes_.data());
+        } else {
+            copy(postings_->tail_freq_codes_.begin(), postings_->tail_freq_codes_.end(), freq_codes_.begin());
+        }
+        freq_codes_loaded_ = true;
+    }
+    return (*term_freq_values_)[freq_codes_[pos_]];
+}
+
+void PostingCursor::Next() {
+    if (++pos_ == block_size_) {
+        LoadBlock(block_index_ + 1);
+    }
+}
+
+void PostingCursor::SkipTo(int document_index) {
+    if (AtEnd() || GetDocument() >= document_index) {
+        return;
+    }
+    const auto& blocks = postings_->blocks_;
+    if (documents_[block_size_ - 1] < document_index) {
+        // Экспоненциальный поиск по данным пропуска: при пересечении списков цель обычно близко.
+        size_t from = min(block_index_ + 1, blocks.size());
+        size_t last = from;
+        for (size_t step = 1; last < blocks.size() && blocks[last].last_document < document_index; step *= 2) {
+            from = last + 1;
+            last += step;
+        }
+        last = min(last, blocks.size());
+        const auto block_it = lower_bound(blocks.begin() + from, blocks.begin() + last, document_index,
+                                          [](const PostingBlock& block, int value) {
+                                              return block.last_document < value;
+                                          });
+        LoadBlock(block_it - blocks.begin());
+        if (AtEnd()) {
+            return;
+        }
+    }
+    pos_ = lower_bound(documents_.begin() + pos_, documents_.begin() + block_size_, document_index) - documents_.begin();
+    if (pos_ == block_size_) {
+        LoadBlock(block_index_ + 1);
+    }
+}
+
+// Блок с номером blocks_.size() означает несжатый хвост списка.
+void PostingCursor::LoadBlock(size_t block_index) {
+    block_index_ = block_index;
+    pos_ = 0;
+    freq_codes_loaded_ = false;
+    const auto& blocks = postings_->blocks_;
+    if (block_index < blocks.size()) {
+        block_size_ = blocks[block_index].size;
+        postings_->DecodeDocuments(blocks[block_index], documents_.data());
+    } else if (block_index == blocks.size()) {
+        block_size_ = postings_->tail_documents_.size();
+        copy(postings_->tail_documents_.begin(), postings_->tail_documents_.end(), documents_.begin());
+    } else {
+        block_size_ = 0;
+    }
+}
+
+TermId InvertedIndex::FindTerm(string_view word) const {
+    const auto it = term_ids_.find(word);
+    return it == term_ids_.end() ? NO_TERM : it->second;
+}
+
+TermId InvertedIndex::InternTerm(string_view word) {
+    const auto it = term_ids_.find(word);
+    if (it != term_ids_.end()) {
+        return it->second;
+    }
+    const TermId term_id = static_cast<TermId>(terms_.size());
+    const string& term = terms_.emplace_back(word);
+    term_ids_.emplace(term, term_id);
+    postings_.emplace_back();
+    return term_id;
+}
+
+const string& InvertedIndex::GetTerm(TermId term_id) const {
+    return terms_.at(term_id);
+}
+
+size_t InvertedIndex::GetTermCount() const {
+    return terms_.size();
+}
+
+const PostingList& InvertedIndex::GetPostings(TermId term_id) const {
+    return postings_[term_id];
+}
+
+PostingCursor InvertedIndex::GetCursor(TermId term_id) const {
+    return PostingCursor(postings_[term_id], term_freq_values_);
+}
+
+bool InvertedIndex::Contains(TermId term_id, int document_index) const {
+    PostingCursor cursor = GetCursor(term_id);
+    cursor.SkipTo(document_index);
+    return !cursor.AtEnd() && cursor.GetDocument() == document_index;
+}
+
+void InvertedIndex::AddPosting(TermId term_id, int document_index, double term_freq) {
+    PostingList& postings = postings_[term_id];
+    if (postings.tail_documents_.empty() && !postings.blocks_.empty() && postings.blocks_.back().last_document == document_index) {
+        postings.UnsealLastBlock();
+    }
+    if (!postings.tail_documents_.empty() && postings.tail_documents_.back() == document_index) {
+        term_freq += term_freq_values_[postings.tail_freq_codes_.back()];
+        postings.tail_freq_codes_.back() = InternTermFreq(term_freq);
+    } else {
+        postings.Append(document_index, InternTermFreq(term_freq));
+    }
+    postings.max_term_freq_ = max(postings.max_term_freq_, term_freq);
+}
+
+// Блок с удаляемым вхождением распаковывается и кодируется заново; упакованные данные
+// следующих блоков сдвигаются.
+void InvertedIndex::RemovePosting(TermId term_id, int document_index) {
+    PostingList& postings = postings_[term_id];
+    auto& blocks = postings.blocks_;
+    const auto block_it = lower_bound(blocks.begin(), blocks.end(), document_index, [](const PostingBlock& block, int value) {
+        return block.last_document < value;
+    });
+    if (block_it == blocks.end()) {
+        const auto it = lower_bound(postings.tail_documents_.begin(), postings.tail_documents_.end(), document_index);
+        if (it == postings.tail_documents_.end() || *it != document_index) {
+            return;
+        }
+        postings.tail_freq_codes_.erase(postings.tail_freq_codes_.begin() + (it - postings.tail_documents_.begin()));
+        postings.tail_documents_.erase(it);
+        --postings.size_;
+        return;
+    }
+
+    array<int, PostingList::BLOCK_SIZE> documents;
+    array<uint32_t, PostingList::BLOCK_SIZE> freq_codes;
+    postings.DecodeDocuments(*block_it, documents.data());
+    postings.DecodeFreqCodes(*block_it, freq_codes.data());
+    const size_t size = block_it->size;
+    const size_t pos = lower_bound(documents.begin(), documents.begin() + size, document_index) - documents.begin();
+    if (pos == size || documents[pos] != document_index) {
+        return;
+    }
+    copy(documents.begin() + pos + 1, documents.begin() + size, documents.begin() + pos);
+    copy(freq_codes.begin() + pos + 1, freq_codes.begin() + size, freq_codes.begin() + pos);
+    --postings.size_;
+
+    const uint32_t old_begin = block_it->offset;
+    const uint32_t old_end = block_it + 1 == blocks.end() ? static_cast<uint32_t>(postings.packed_.size()) : (block_it + 1)->offset;
+    vector<uint32_t> packed;
+    if (size > 1) {
+        postings.EncodeBlock(documents.data(), freq_codes.data(), size - 1, *block_it, packed);
+    }
+    postings.packed_.erase(postings.packed_.begin() + old_begin, postings.packed_.begin() + old_end);
+    postings.packed_.insert(postings.packed_.begin() + old_begin, packed.begin(), packed.end());
+    const int64_t shift = static_cast<int64_t>(packed.size()) - (old_end - old_begin);
+    for (auto it = block_it + 1; it != blocks.end(); ++it) {
+        it->offset = static_cast<uint32_t>(it->offset + shift);
+    }
+    if (size > 1) {
+        block_it->offset = old_begin;
+    } else {
+        blocks.erase(block_it);
+    }
+}
+
+void InvertedIndex::AppendPostings(TermId term_id, const vector<int>& document_indexes, const vector<double>& term_freqs) {
+    vector<uint32_t> freq_codes(term_freqs.size());
+    {
+        lock_guard lock(*term_freq_mutex_);
+        for (size_t i = 0; i < term_freqs.size(); ++i) {
+            freq_codes[i] = InternTermFreq(term_freqs[i]);
+        }
+    }
+    PostingList& postings = postings_[term_id];
+    for (size_t i = 0; i < document_indexes.size(); ++i) {
+        postings.Append(document_indexes[i], freq_codes[i]);
+        postings.max_term_freq_ = max(postings.max_term_freq_, term_freqs[i]);
+    }
+}
+
+void InvertedIndex::CompactPostings() {
+    for (PostingList& postings : postings_) {
+        postings.Compact();
+    }
+}
+
+void InvertedIndex::RenumberDocuments(const vector<int>& new_indexes) {
+    array<int, PostingList::BLOCK_SIZE> documents;
+    array<uint32_t, PostingList::BLOCK_SIZE> freq_codes;
+    for (PostingList& postings : postings_) {
+        PostingList renumbered;
+        renumbered.max_term_freq_ = postings.max_term_freq_;
+        for (const PostingBlock& block : postings.blocks_) {
+            postings.DecodeDocuments(block, documents.data());
+            postings.DecodeFreqCodes(block, freq_codes.data());
+            for (size_t i = 0; i < block.size; ++i) {
+                renumbered.Append(new_indexes[documents[i]], freq_codes[i]);
+            }
+        }
+        for (size_t i = 0; i < postings.tail_documents_.size(); ++i) {
+            renumbered.Append(new_indexes[postings.tail_documents_[i]], postings.tail_freq_codes_[i]);
+        }
+        renumbered.Compact();
+        postings = move(renumbered);
+    }
+}
+
+size_t InvertedIndex::GetPostingsMemoryUsage() const {
+    size_t bytes = postings_.capacity() * sizeof(PostingList)
+                   + term_freq_values_.capacity() * sizeof(double)
+                   + term_freq_codes_.size() * (sizeof(double) + sizeof(uint32_t) + sizeof(void*));
+    for (const PostingList& postings : postings_) {
+        bytes += postings.blocks_.capacity() * sizeof(PostingBlock)
+                 + postings.packed_.capacity() * sizeof(uint32_t)
+                 + postings.tail_documents_.capacity() * sizeof(int)
+                 + postings.tail_freq_codes_.capacity() * sizeof(uint32_t);
+    }
+    return bytes;
+}
+
+uint32_t InvertedIndex::InternTermFreq(double term_freq) {
+    const auto [it, inserted] = term_freq_codes_.emplace(term_freq, static_cast<uint32_t>(term_freq_values_.size()));
+    if (inserted) {
+        term_freq_values_.push_back(term_freq);
+    }
+    return it->second;
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+using TermId = int;
+
+// Данные пропуска для сжатого блока: границы блока позволяют перескакивать его целиком.
+struct PostingBlock {
+    int first_document = 0;
+    int last_document = 0;
+    uint32_t offset = 0;
+    uint16_t size = 0;
+    uint8_t document_bits = 0;
+    uint8_t freq_bits = 0;
+};
+
+// Список вхождений терма: индексы документов в плотной таблице SearchServer по возрастанию
+// и их TF. Полные блоки по BLOCK_SIZE вхождений хранятся сжатыми: разности соседних индексов
+// и коды TF упакованы в фиксированное для блока число бит. Коды ссылаются на общую для индекса
+// таблицу различных значений TF, поэтому сжатие TF не теряет точности. Последние вхождения,
+// ещё не набравшие блок, хранятся несжатыми, пока Compact не упакует их в неполный блок.
+// Читается через PostingCursor.
+class PostingList {
+public:
+    static constexpr size_t BLOCK_SIZE = 128;
+
+    size_t size() const;
+    bool empty() const;
+    // Верхняя граница TF по списку; после удалений может оказаться завышенной.
+    double GetMaxTermFreq() const;
+
+private:
+    friend class InvertedIndex;
+    friend class PostingCursor;
+
+    void Append(int document_index, uint32_t freq_code);
+    void SealTail();
+    void UnsealLastBlock();
+    void Compact();
+    void EncodeBlock(const int* documents, const uint32_t* freq_codes, size_t size, PostingBlock& block,
+                     std::vector<uint32_t>& packed) const;
+    void DecodeDocuments(const PostingBlock& block, int* documents) const;
+    void DecodeFreqCodes(const PostingBlock& block, uint32_t* freq_codes) const;
+
+    std::vector<PostingBlock> blocks_;
+    std::vector<uint32_t> packed_;
+    std::vector<int> tail_documents_;
+    std::vector<uint32_t> tail_freq_codes_;
+    size_t size_ = 0;
+    double max_term_freq_ = 0.0;
+};
+
+// Последовательный обход списка вхождений с распаковкой по одному блоку.
+// Коды TF распаковываются, только если TF в блоке действительно запрошена.
+class PostingCursor {
+public:
+    PostingCursor(const PostingList& postings, const std::vector<double>& term_freq_values);
+
+    bool AtEnd() const;
+    int GetDocument() const;
+    double GetTermFreq() const;
+    void Next();
+    // Переходит к первому вхождению с индексом документа не меньше document_index;
+    // блоки, целиком лежащие левее, пропускаются без распаковки.
+    void SkipTo(int document_index);
+
+private:
+    void LoadBlock(size_t block_index);
+
+    const PostingList* postings_;
+    const std::vector<double>* term_freq_values_;
+    size_t block_index_ = 0;
+    size_t block_size_ = 0;
+    size_t pos_ = 0;
+    mutable bool freq_codes_loaded_ = false;
+    std::array<int, PostingList::BLOCK_SIZE> documents_;
+    mutable std::array<uint32_t, PostingList::BLOCK_SIZE> freq_codes_;
+};
+
+class InvertedIndex {
+public:
+    static constexpr TermId NO_TERM = -1;
+
+    TermId FindTerm(std::string_view word) const;
+    TermId InternTerm(std::string_view word);
+    const std::string& GetTerm(TermId term_id) const;
+    size_t GetTermCount() const;
+
+    const PostingList& GetPostings(TermId term_id) const;
+    PostingCursor GetCursor(TermId term_id) const;
+    bool Contains(TermId term_id, int document_index) const;
+
+    // Индексы документов должны поступать в неубывающем порядке:
+    // повторное вхождение в тот же документ увеличивает его TF.
+    void AddPosting(TermId term_id, int document_index, double term_freq);
+    void RemovePosting(TermId term_id, int document_index);
+    // Дописывает в конец списка вхождения с индексами документов больше уже имеющихся.
+    // Для разных term_id безопасно вызывать из разных потоков.
+    void AppendPostings(TermId term_id, const std::vector<int>& document_indexes, const std::vector<double>& term_freqs);
+
+    // Упаковывает несжатые хвосты всех списков; следующая вставка в список распакует
+    // его последний неполный блок обратно.
+    void CompactPostings();
+    // Заменяет индекс документа d на new_indexes[d] с сохранением порядка и упаковывает списки.
+    // В списках не должно остаться документов с new_indexes[d] < 0.
+    void RenumberDocuments(const std::vector<int>& new_indexes);
+
+    // Число байт, занятых списками вхождений и таблицей TF.
+    size_t GetPostingsMemoryUsage() const;
+
+private:
+    uint32_t InternTermFreq(double term_freq);
+
+    std::deque<std::string> terms_;
+    std::unordered_map<std::string_view, TermId> term_ids_;
+    std::vector<PostingList> postings_;
+
+    std::vector<double> term_freq_values_;
+    std::unordered_map<double, uint32_t> term_freq_codes_;
+    std::unique_ptr<std::mutex> term_freq_mutex_ = std::make_unique<std::mutex>();
+};
@@ -2,14 +2,16 @@
 #include "request_queue.h"
 #include "document.h"
 #include "string_processing.h"
-#include "paginator.h"
 #include "read_input_functions.h"
+#include "remove_duplicates.h"
+#include "stream_protocol.h"
 
+#include <chrono>
 #include <iostream>
 #include <sstream>
 #include <vector>
 #include <string>
-#include <set>
+#include <string_view>
 
 using namespace std;
 
@@ -18,38 +20,31 @@ void PrintHelp() {
          << "  add <id> <status> <rating1> <rating2> ... <ratingN> -- <text> : Add a document\n"
          << "  find : Search for documents\n"
          << "  count : Show document count\n"
+         << "  dedup : Remove documents with duplicate word sets\n"
+         << "  stats : Show search statistics for the last minute and hour\n"
          << "  exit : Exit the program\n";
 }
 
-DocumentStatus ParseSingleStatus(const string& status_str) {
-    if (status_str == "ACTUAL") return DocumentStatus::ACTUAL;
-    if (status_str == "IRRELEVANT") return DocumentStatus::IRRELEVANT;
-    if (status_str == "BANNED") return DocumentStatus::BANNED;
-    if (status_str == "REMOVED") return DocumentStatus::REMOVED;
-    throw invalid_argument("Invalid status: " + status_str);
-}
-
-set<DocumentStatus> ParseStatus(const string& status_input) {
-    set<DocumentStatus> statuses;
+DocumentStatusSet ParseStatus(const string& status_input) {
     if (status_input == "ALL") {
-        return {DocumentStatus::ACTUAL, DocumentStatus::IRRELEVANT, 
-                DocumentStatus::BANNED, DocumentStatus::REMOVED};
+        return DocumentStatusSet::All();
     }
     
-    vector<string> status_words = SplitIntoWords(status_input);
-    for (const string& status_str : status_words) {
-        statuses.insert(ParseSingleStatus(status_str));
+    DocumentStatusSet statuses;
+    vector<string_view> status_words = SplitIntoWords(status_input);
+    for (string_view status_str : status_words) {
+        statuses.Add(ParseDocumentStatus(status_str));
     }
     return statuses;
 }
 
-vector<int> ParseRatings(const vector<string>& words, size_t start_index, size_t end_index) {
+vector<int> ParseRatings(const vector<string_view>& words, size_t start_index, size_t end_index) {
     vector<int> ratings;
     for (size_t i = start_index; i < end_index; ++i) {
         try {
-            ratings.push_back(stoi(words[i]));
+            ratings.push_back(stoi(string(words[i])));
         } catch (const invalid_argument&) {
-            throw invalid_argument("Invalid rating: " + words[i]);
+            throw invalid_argument("Invalid rating: " + string(words[i]));
         }
     }
     return ratings;
@@ -58,7 +53,7 @@ vector<int> ParseRatings(const vector<string>& words, size_t start_index, size_t
 void AddDocument(SearchServer& server) {
     cout << "Enter: id status rating1 rating2 ... ratingN -- document text\n";
     string input = ReadLine();
-    vector<string> parts = SplitIntoWords(input);
+    vector<string_view> parts = SplitIntoWords(input);
 
     auto separator_it = find(parts.begin(), parts.end(), "--");
     if (separator_it == parts.end() || separator_it < parts.begin() + 2) {
@@ -73,17 +68,18 @@ void AddDocument(SearchServer& server) {
 
     int id;
     try {
-        id = stoi(parts[0]);
+        id = stoi(string(parts[0]));
     } catch (const invalid_argument&) {
-        throw invalid_argument("Invalid document ID: " + parts[0]);
+        throw invalid_argument("Invalid document ID: " + string(parts[0]));
     }
 
-    DocumentStatus status = ParseSingleStatus(parts[1]);
+    DocumentStatus status = ParseDocumentStatus(parts[1]);
     vector<int> ratings = ParseRatings(parts, 2, separator_index);
 
     string document_text;
     for (size_t i = separator_index + 1; i < parts.size(); ++i) {
-        document_text += parts[i] + (i < parts.size() - 1 ? " " : "");
+        document_text += parts[i];
+        document_text += (i < parts.size() - 1 ? " " : "");
     }
     if (document_text.empty()) {
         throw invalid_argument("Document text cannot be empty");
@@ -93,10 +89,10 @@ void AddDocument(SearchServer& server) {
     cout << "Document added successfully\n";
 }
 
-void FindDocuments(SearchServer& server, RequestQueue& request_queue) {
+void FindDocuments(RequestQueue& request_queue) {
     cout << "Enter status (ACTUAL, IRRELEVANT, BANNED, REMOVED, or multiple statuses separated by spaces, or ALL):\n";
     string status_input = ReadLine();
-    set<DocumentStatus> statuses;
+    DocumentStatusSet statuses;
     try {
         statuses = ParseStatus(status_input);
     } catch (const invalid_argument& e) {
@@ -107,29 +103,61 @@ void FindDocuments(SearchServer& server, RequestQueue& request_queue) {
     cout << "Enter search query:\n";
     string query = ReadLine();
     
-    vector<Document> documents = request_queue.AddFindRequest(query, [&statuses](int, DocumentStatus document_status, int) {
-        return statuses.count(document_status) > 0;
-    });
-    
-    if (documents.empty()) {
+    // Каждая страница запрашивается отдельно от последнего документа предыдущей,
+    // так что непросмотренные страницы не выбираются.
+    TopKOptions options;
+    options.count = 2;
+    ResultPage page = request_queue.AddFindPageRequest(query, statuses, options);
+    if (page.documents.empty()) {
         cout << "No documents found\n";
         return;
     }
 
-    const size_t page_size = 2;
-    auto paginated_results = Paginate(documents, page_size);
-    
-    cout << "Found " << documents.size() << " documents:\n";
-    size_t page_number = 1;
-    for (const auto& page : paginated_results) {
-        cout << "Page " << page_number++ << ":\n";
-        cout << page << "\n";
+    for (size_t page_number = 1;; ++page_number) {
+        cout << "Page " << page_number << ":\n";
+        for (const Document& document : page.documents) {
+            cout << document;
+        }
+        cout << "\n";
+        if (!page.has_more) {
+            break;
+        }
+        cout << "Show next page? (y/n):\n";
+        if (ReadLine() != "y") {
+            break;
+        }
+        options.after = page.documents.back();
+        page = request_queue.AddFindPageRequest(query, statuses, options);
     }
 }
 
-int main() {
+void PrintStatistics(const RequestQueue& request_queue) {
+    for (const auto& [name, window] : {pair{"minute"s, chrono::minutes(1)}, pair{"hour"s, chrono::minutes(60)}}) {
+        const RequestStatistics::Snapshot snapshot = request_queue.GetStatistics().GetSnapshot(window);
+        cout << "Last " << name << ": " << snapshot.request_count << " requests";
+        if (snapshot.request_count > 0) {
+            cout << ", empty " << snapshot.GetEmptyResultRate() * 100 << "%"
+                 << ", p50 <= " << snapshot.GetLatencyQuantile(0.5).count() << " us"
+                 << ", p99 <= " << snapshot.GetLatencyQuantile(0.99).count() << " us"
+                 << ", results " << snapshot.result_count * 1.0 / snapshot.request_count << " per request"
+                 << ", postings " << snapshot.posting_count * 1.0 / snapshot.request_count << " per request";
+        }
+        cout << "\n";
+    }
+    cout << "Empty results among the last 1440 requests: " << request_queue.GetNoResultRequests() << "\n";
+    if constexpr (INSTRUMENTATION_ENABLED) {
+        cout << SearchInstrumentation::GetSnapshot() << "\n";
+    }
+}
+
+int main(int argc, char* argv[]) {
     try {
         SearchServer search_server("and in at"s);
+        // --stream: построчный протокол StreamProtocol на stdin/stdout вместо диалога.
+        if (argc > 1 && argv[1] == "--stream"sv) {
+            ServeStream(search_server, 0, 1);
+            return 0;
+        }
         RequestQueue request_queue(search_server);
 
         cout << "Search Engine started. Type 'help' for commands.\n";
@@ -145,9 +173,17 @@ int main() {
                 } else if (command == "add") {
                     AddDocument(search_server);
                 } else if (command == "find") {
-                    FindDocuments(search_server, request_queue);
+                    FindDocuments(request_queue);
                 } else if (command == "count") {
                     cout << "Total documents: " << search_server.GetDocumentCount() << "\n";
+                } else if (command == "stats") {
+                    PrintStatistics(request_queue);
+                } else if (command == "dedup") {
+                    const vector<int> removed_ids = RemoveDuplicates(search_server);
+                    for (const int document_id : removed_ids) {
+                        cout << "Found duplicate document id " << document_id << "\n";
+                    }
+                    cout << "Removed " << removed_ids.size() << " duplicate documents\n";
                 } else if (command == "exit") {
                     cout << "Exiting program\n";
                     break;
@@ -2,9 +2,11 @@
 #include "document.h"
 
 #include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <stdexcept>
 #include <string>
 #include <iostream>
-#include <vector>
 
 template <typename Iterator>
     class IteratorRange {
@@ -28,34 +30,83 @@ template <typename Iterator>
         size_t size_;
     };
 
+    // Страницы не хранятся, а строятся при обращении: для итераторов произвольного доступа
+    // переход к странице и её построение занимают O(1).
     template <typename Iterator>
 class Paginator {
 public:
-    Paginator(Iterator begin, Iterator end, size_t page_size) {
-        for (size_t left = distance(begin, end); left > 0;) {
-            const size_t current_page_size = std::min(page_size, left);
-            const Iterator current_page_end = next(begin, current_page_size);
-            pages_.push_back({begin, current_page_end});
-
-            left -= current_page_size;
-            begin = current_page_end;
+    class PageIterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = IteratorRange<Iterator>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = IteratorRange<Iterator>;
+
+        PageIterator(const Paginator* paginator, size_t page_index)
+            : paginator_(paginator), page_index_(page_index) {
+        }
+
+        IteratorRange<Iterator> operator*() const {
+            return paginator_->GetPage(page_index_);
+        }
+
+        PageIterator& operator++() {
+            ++page_index_;
+            return *this;
+        }
+
+        PageIterator operator++(int) {
+            PageIterator previous = *this;
+            ++page_index_;
+            return previous;
+        }
+
+        bool operator==(const PageIterator& other) const {
+            return page_index_ == other.page_index_;
+        }
+
+        bool operator!=(const PageIterator& other) const {
+            return page_index_ != other.page_index_;
+        }
+
+    private:
+        const Paginator* paginator_;
+        size_t page_index_;
+    };
+
+    Paginator(Iterator begin, Iterator end, size_t page_size)
+        : begin_(begin)
+        , item_count_(std::distance(begin, end))
+        , page_size_(page_size) {
+        if (page_size == 0) {
+            throw std::invalid_argument("page size must be positive");
         }
     }
 
-    auto begin() const {
-        return pages_.begin();
+    PageIterator begin() const {
+        return {this, 0};
     }
 
-    auto end() const {
-        return pages_.end();
+    PageIterator end() const {
+        return {this, size()};
     }
 
     size_t size() const {
-        return pages_.size();
+        return (item_count_ + page_size_ - 1) / page_size_;
+    }
+
+    IteratorRange<Iterator> GetPage(size_t page_index) const {
+        const size_t first = std::min(page_index * page_size_, item_count_);
+        const size_t last = std::min(first + page_size_, item_count_);
+        const Iterator page_begin = std::next(begin_, first);
+        return {page_begin, std::next(page_begin, last - first)};
     }
 
 private:
-    std::vector<IteratorRange<Iterator>> pages_;
+    Iterator begin_;
+    size_t item_count_;
+    size_t page_size_;
 };
     
     template <typename Iterator>
@@ -65,3 +116,8 @@ private:
         }
         return output;
     }
+
+template <typename Container>
+auto Paginate(const Container& c, size_t page_size) {
+    return Paginator(begin(c), end(c), page_size);
+}
@@ -0,0 +1,67 @@
+#include "process_queries.h"
+
+#include <algorithm>
+#include <execution>
+
+using namespace std;
+
+vector<vector<Document>> ProcessQueries(const SearchServer& search_server, const vector<string>& queries) {
+    vector<vector<Document>> results(queries.size());
+    transform(execution::par, queries.begin(), queries.end(), results.begin(),
+              [&search_server](const string& query) {
+                  return search_server.FindTopDocuments(query);
+              });
+    return results;
+}
+
+JoinedDocuments ProcessQueriesJoined(const SearchServer& search_server, const vector<string>& queries) {
+    constexpr size_t slot_size = MAX_RESULT_DOCUMENT_COUNT;
+    vector<Document> documents(queries.size() * slot_size);
+    vector<size_t> query_ends(queries.size());
+    vector<size_t> query_indexes(queries.size());
+    for (size_t i = 0; i < queries.size(); ++i) {
+        query_indexes[i] = i;
+    }
+    for_each(execution::par, query_indexes.begin(), query_indexes.end(),
+             [&](size_t query_index) {
+                 const vector<Document> result = search_server.FindTopDocuments(queries[query_index]);
+                 copy(result.begin(), result.end(), documents.begin() + query_index * slot_size);
+                 query_ends[query_index] = result.size();
+             });
+    // Участок запроса сдвигается не дальше своего начала, поэтому сдвиг слева направо ничего не затирает.
+    size_t size = 0;
+    for (size_t query_index = 0; query_index < queries.size(); ++query_index) {
+        const auto slot = documents.begin() + query_index * slot_size;
+        move(slot, slot + query_ends[query_index], documents.begin() + size);
+        size += query_ends[query_index];
+        query_ends[query_index] = size;
+    }
+    documents.resize(size);
+    return JoinedDocuments(move(documents), move(query_ends));
+}
+
+JoinedDocuments::JoinedDocuments(vector<Document> documents, vector<size_t> query_ends)
+        : documents_(move(documents))
+        , query_ends_(move(query_ends)) {
+}
+
+JoinedDocuments::Iterator JoinedDocuments::begin() const {
+    return documents_.begin();
+}
+
+JoinedDocuments::Iterator JoinedDocuments::end() const {
+    return documents_.end();
+}
+
+size_t JoinedDocuments::size() const {
+    return documents_.size();
+}
+
+bool JoinedDocuments::empty() const {
+    return documents_.empty();
+}
+
+IteratorRange<JoinedDocuments::Iterator> JoinedDocuments::GetQueryDocuments(size_t query_index) const {
+    const size_t query_begin = query_index == 0 ? 0 : query_ends_.at(query_index - 1);
+    return {documents_.begin() + query_begin, documents_.begin() + query_ends_.at(query_index)};
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "document.h"
+#include "paginator.h"
+#include "search_server.h"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+std::vector<std::vector<Document>> ProcessQueries(const SearchServer& search_server, const std::vector<std::string>& queries);
+
+// Результаты нескольких запросов подряд в одном векторе, в порядке запросов.
+class JoinedDocuments {
+public:
+    using Iterator = std::vector<Document>::const_iterator;
+
+    // query_ends[i] — позиция в documents сразу за результатами запроса i.
+    JoinedDocuments(std::vector<Document> documents, std::vector<size_t> query_ends);
+
+    Iterator begin() const;
+    Iterator end() const;
+    size_t size() const;
+    bool empty() const;
+
+    // Результаты запроса query_index.
+    IteratorRange<Iterator> GetQueryDocuments(size_t query_index) const;
+
+private:
+    std::vector<Document> documents_;
+    std::vector<size_t> query_ends_;
+};
+
+// Вложенные векторы не строятся: каждый запрос пишет выдачу в свой участок из
+// MAX_RESULT_DOCUMENT_COUNT ячеек общего вектора, после чего участки сдвигаются вплотную.
+JoinedDocuments ProcessQueriesJoined(const SearchServer& search_server, const std::vector<std::string>& queries);
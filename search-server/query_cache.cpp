@@ -0,0 +1,65 @@
+#include "query_cache.h"
+
+using namespace std;
+
+QueryCache::QueryCache(size_t memory_budget)
+        : memory_budget_(memory_budget) {
+}
+
+const vector<Document>* QueryCache::Find(const string& key, uint64_t generation) {
+    SwitchGeneration(generation);
+    const auto it = key_to_entry_.find(key);
+    if (it == key_to_entry_.end()) {
+        ++misses_;
+        return nullptr;
+    }
+    ++hits_;
+    entries_.splice(entries_.begin(), entries_, it->second);
+    return &it->second->documents;
+}
+
+void QueryCache::Insert(const string& key, const vector<Document>& documents, uint64_t generation) {
+    SwitchGeneration(generation);
+    const size_t size = ComputeEntrySize(key, documents);
+    if (size > memory_budget_ || key_to_entry_.count(key)) {
+        return;
+    }
+    while (memory_usage_ + size > memory_budget_) {
+        memory_usage_ -= entries_.back().size;
+        key_to_entry_.erase(entries_.back().key);
+        entries_.pop_back();
+    }
+    entries_.push_front({key, documents, size});
+    key_to_entry_.emplace(key, entries_.begin());
+    memory_usage_ += size;
+}
+
+void QueryCache::Clear() {
+    entries_.clear();
+    key_to_entry_.clear();
+    memory_usage_ = 0;
+}
+
+size_t QueryCache::GetHitCount() const {
+    return hits_;
+}
+
+size_t QueryCache::GetMissCount() const {
+    return misses_;
+}
+
+size_t QueryCache::GetMemoryUsage() const {
+    return memory_usage_;
+}
+
+size_t QueryCache::ComputeEntrySize(const string& key, const vector<Document>& documents) {
+    // Ключ хранится дважды: в записи и в хеш-таблице; плюс узлы списка и таблицы.
+    return 2 * key.size() + documents.size() * sizeof(Document) + sizeof(Entry) + 4 * sizeof(void*);
+}
+
+void QueryCache::SwitchGeneration(uint64_t generation) {
+    if (generation != generation_) {
+        Clear();
+        generation_ = generation;
+    }
+}
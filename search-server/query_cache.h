@@ -0,0 +1,44 @@
+#pragma once
+
+#include "document.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// LRU-кэш выдачи с ограничением по памяти. Все записи относятся к одному поколению
+// индекса: при обращении с другим поколением кэш очищается целиком.
+class QueryCache {
+public:
+    explicit QueryCache(size_t memory_budget);
+
+    // nullptr, если запроса нет в кэше текущего поколения.
+    const std::vector<Document>* Find(const std::string& key, uint64_t generation);
+    void Insert(const std::string& key, const std::vector<Document>& documents, uint64_t generation);
+    void Clear();
+
+    size_t GetHitCount() const;
+    size_t GetMissCount() const;
+    size_t GetMemoryUsage() const;
+
+private:
+    struct Entry {
+        std::string key;
+        std::vector<Document> documents;
+        size_t size;
+    };
+
+    static size_t ComputeEntrySize(const std::string& key, const std::vector<Document>& documents);
+    void SwitchGeneration(uint64_t generation);
+
+    size_t memory_budget_;
+    size_t memory_usage_ = 0;
+    uint64_t generation_ = 0;
+    std::list<Entry> entries_;
+    std::unordered_map<std::string, std::list<Entry>::iterator> key_to_entry_;
+    size_t hits_ = 0;
+    size_t misses_ = 0;
+};
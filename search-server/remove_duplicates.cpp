@@ -0,0 +1,43 @@
+#include "remove_duplicates.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <unordered_map>
+
+using namespace std;
+
+namespace {
+
+uint64_t ComputeFingerprint(const vector<TermId>& term_ids) {
+    uint64_t hash = 14695981039346656037ull;
+    for (const TermId term_id : term_ids) {
+        hash ^= static_cast<uint64_t>(term_id);
+        hash *= 1099511628211ull;
+    }
+    return hash ^ term_ids.size();
+}
+
+}
+
+vector<int> RemoveDuplicates(SearchServer& search_server) {
+    unordered_map<uint64_t, vector<int>> fingerprint_to_ids;
+    vector<int> duplicate_ids;
+    for (const int document_id : search_server) {
+        const vector<TermId>& term_ids = search_server.GetDocumentTermIds(document_id);
+        vector<int>& same_fingerprint_ids = fingerprint_to_ids[ComputeFingerprint(term_ids)];
+        const bool is_duplicate = any_of(same_fingerprint_ids.begin(), same_fingerprint_ids.end(),
+                                         [&](int original_id) {
+                                             return search_server.GetDocumentTermIds(original_id) == term_ids;
+                                         });
+        if (is_duplicate) {
+            duplicate_ids.push_back(document_id);
+        } else {
+            same_fingerprint_ids.push_back(document_id);
+        }
+    }
+
+    for (const int document_id : duplicate_ids) {
+        search_server.RemoveDocument(document_id);
+    }
+    return duplicate_ids;
+}
@@ -2,15 +2,34 @@
 
 using namespace std;
 
-RequestQueue::RequestQueue(const SearchServer& search_server)
+RequestQueue::RequestQueue(const SearchServer& search_server, size_t cache_memory_budget,
+                           shared_ptr<RequestStatistics> statistics)
         :search_server_(search_server)
+        ,cache_(cache_memory_budget)
+        ,statistics_(move(statistics))
     {
     }
 
     
 
     vector<Document> RequestQueue::AddFindRequest(const string& raw_query, DocumentStatus status) {
-        return RequestQueue::AddFindRequest(raw_query, [status](int document_id, DocumentStatus document_status, int rating) {return document_status == status;});
+        return AddFindRequest(raw_query, DocumentStatusSet(status));
+    }
+
+    vector<Document> RequestQueue::AddFindRequest(const string& raw_query, DocumentStatusSet statuses) {
+        // Запрос разбирается один раз: по разбору строятся ключ кэша, выдача и объём работы.
+        const auto start = RequestStatistics::Clock::now();
+        const SearchServer::Query query = search_server_.ParseQuery(raw_query);
+        const string key = to_string(statuses.GetMask()) + ':' + search_server_.NormalizeQuery(query);
+        const uint64_t generation = search_server_.GetGeneration();
+        if (const vector<Document>* cached = cache_.Find(key, generation)) {
+            AddRequestResult(*cached, RequestStatistics::Clock::now() - start, 0);
+            return *cached;
+        }
+        vector<Document> result = search_server_.FindTopDocuments(query, statuses);
+        cache_.Insert(key, result, generation);
+        AddRequestResult(result, RequestStatistics::Clock::now() - start, search_server_.GetQueryPostingCount(query));
+        return result;
     }
 
     vector<Document> RequestQueue::AddFindRequest(const string& raw_query) {
@@ -20,8 +39,25 @@ RequestQueue::RequestQueue(const SearchServer& search_server)
     int RequestQueue::GetNoResultRequests() const {
         return null_results_;
     }
-    RequestQueue::QueryResult::QueryResult(const string& raw_query, bool nul_or_one){
-        query = raw_query;
-        null = nul_or_one;
+
+    const QueryCache& RequestQueue::GetCache() const {
+        return cache_;
+    }
+    const RequestStatistics& RequestQueue::GetStatistics() const {
+        return *statistics_;
+    }
+
+    void RequestQueue::AddRequestResult(const vector<Document>& result, RequestStatistics::Clock::duration latency,
+                                        uint64_t posting_count) {
+        const size_t slot = request_count_ % min_in_day_;
+        if (request_count_ >= min_in_day_ && null_requests_[slot]) {
+            --null_results_;
+        }
+        null_requests_[slot] = result.empty();
+        if (result.empty()) {
+            ++null_results_;
+        }
+        ++request_count_;
+        statistics_->Record(latency, result.size(), posting_count);
     }
 
@@ -1,46 +1,63 @@
 #pragma once
 
+#include "query_cache.h"
+#include "request_statistics.h"
 #include "search_server.h"
 
+#include <bitset>
+#include <chrono>
+#include <memory>
 #include <string>
-#include <deque>
+
+const size_t DEFAULT_QUERY_CACHE_MEMORY = 16 << 20;
 
 class RequestQueue {
 public:
-    explicit RequestQueue(const SearchServer& search_server);
+    // Несколько очередей, например по одной на поток, могут писать в общую statistics.
+    explicit RequestQueue(const SearchServer& search_server, size_t cache_memory_budget = DEFAULT_QUERY_CACHE_MEMORY,
+                          std::shared_ptr<RequestStatistics> statistics = std::make_shared<RequestStatistics>());
 
+    // Запросы с произвольным предикатом идут мимо кэша.
     template <typename DocumentPredicate>
     std::vector<Document> AddFindRequest(const std::string& raw_query, DocumentPredicate document_predicate){
-        using namespace std;
-        const auto& result = search_server_.FindTopDocuments(raw_query, document_predicate);
-        bool null = result.empty();
-        requests_.push_back({raw_query, null});
-        if(null){
-            ++null_results_;
-        }
-        if(requests_.size() > min_in_day_){
-            if(requests_.front().null){
-                --null_results_;
-            }
-            requests_.pop_front();
-        }
+        const auto start = RequestStatistics::Clock::now();
+        const SearchServer::Query query = search_server_.ParseQuery(raw_query);
+        const auto& result = search_server_.FindTopDocuments(query, document_predicate);
+        AddRequestResult(result, RequestStatistics::Clock::now() - start, search_server_.GetQueryPostingCount(query));
         return result;
     }
 
+    // Страницы выдачи тоже идут мимо кэша: каждая учитывается в статистике как отдельный запрос.
+    template <typename DocumentPredicate>
+    ResultPage AddFindPageRequest(const std::string& raw_query, DocumentPredicate document_predicate, const TopKOptions& options) {
+        const auto start = RequestStatistics::Clock::now();
+        ResultPage page = search_server_.FindTopDocumentsPage(raw_query, document_predicate, options);
+        const auto latency = RequestStatistics::Clock::now() - start;
+        AddRequestResult(page.documents, latency, search_server_.GetQueryPostingCount(search_server_.ParseQuery(raw_query)));
+        return page;
+    }
+
     
     std::vector<Document> AddFindRequest(const std::string& raw_query, DocumentStatus status);
+    // Запросы с набором статусов кэшируются так же, как с одним статусом.
+    std::vector<Document> AddFindRequest(const std::string& raw_query, DocumentStatusSet statuses);
     
     std::vector<Document> AddFindRequest(const std::string& raw_query);
 
     int GetNoResultRequests() const;
+
+    const QueryCache& GetCache() const;
+
+    const RequestStatistics& GetStatistics() const;
 private:
-    struct QueryResult {
-        QueryResult(const std::string& raw_query, bool nul_or_one);
-        std::string query;
-        bool null;
-    };
-    std::deque<QueryResult> requests_;
     const static int min_in_day_ = 1440;
     const SearchServer &search_server_;
+    // Признаки пустой выдачи последних min_in_day_ запросов, кольцом по request_count_.
+    std::bitset<min_in_day_> null_requests_;
+    uint64_t request_count_ = 0;
     int null_results_ = 0;
+    QueryCache cache_;
+    std::shared_ptr<RequestStatistics> statistics_;
+
+    void AddRequestResult(const std::vector<Document>& result, RequestStatistics::Clock::duration latency, uint64_t posting_count);
 };
\ No newline at end of file
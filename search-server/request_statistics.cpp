@@ -0,0 +1,129 @@
+#include "request_statistics.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+namespace {
+
+size_t GetLatencyBucket(RequestStatistics::Clock::duration latency) {
+    uint64_t microseconds = static_cast<uint64_t>(max<int64_t>(chrono::duration_cast<chrono::microseconds>(latency).count(), 0));
+    size_t bucket = 0;
+    while (microseconds != 0 && bucket + 1 < RequestStatistics::LATENCY_BUCKET_COUNT) {
+        ++bucket;
+        microseconds >>= 1;
+    }
+    return bucket;
+}
+
+}  // namespace
+
+double RequestStatistics::Snapshot::GetEmptyResultRate() const {
+    return request_count == 0 ? 0.0 : empty_result_count * 1.0 / request_count;
+}
+
+chrono::microseconds RequestStatistics::Snapshot::GetLatencyQuantile(double quantile) const {
+    const uint64_t rank = static_cast<uint64_t>(quantile * request_count);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < LATENCY_BUCKET_COUNT; ++i) {
+        seen += latency_histogram[i];
+        if (seen > rank) {
+            return chrono::microseconds(uint64_t(1) << i);
+        }
+    }
+    return chrono::microseconds(uint64_t(1) << (LATENCY_BUCKET_COUNT - 1));
+}
+
+RequestStatistics::RequestStatistics(Clock::duration bucket_width, size_t bucket_count)
+    : bucket_width_(bucket_width)
+    , buckets_(bucket_count) {
+    if (bucket_width <= Clock::duration::zero() || bucket_count == 0) {
+        throw invalid_argument("statistics window must have a positive bucket width and count"s);
+    }
+}
+
+void RequestStatistics::Record(Clock::duration latency, size_t result_count, uint64_t posting_count, Clock::time_point now) {
+    Bucket* bucket = AcquireBucket(GetEpoch(now));
+    if (bucket == nullptr) {
+        return;
+    }
+    bucket->request_count.fetch_add(1, memory_order_relaxed);
+    if (result_count == 0) {
+        bucket->empty_result_count.fetch_add(1, memory_order_relaxed);
+    }
+    bucket->result_count.fetch_add(result_count, memory_order_relaxed);
+    bucket->posting_count.fetch_add(posting_count, memory_order_relaxed);
+    bucket->total_latency.fetch_add(latency.count(), memory_order_relaxed);
+    bucket->latency_histogram[GetLatencyBucket(latency)].fetch_add(1, memory_order_relaxed);
+}
+
+RequestStatistics::Snapshot RequestStatistics::GetSnapshot(Clock::duration window, Clock::time_point now) const {
+    const int64_t last_epoch = GetEpoch(now);
+    const int64_t window_buckets = min<int64_t>((window + bucket_width_ - Clock::duration(1)) / bucket_width_,
+                                                static_cast<int64_t>(buckets_.size()));
+    Snapshot snapshot;
+    for (const Bucket& bucket : buckets_) {
+        const int64_t epoch = bucket.epoch.load(memory_order_acquire);
+        if (epoch < 0 || epoch > last_epoch || epoch <= last_epoch - window_buckets) {
+            continue;
+        }
+        Snapshot part;
+        part.request_count = bucket.request_count.load(memory_order_relaxed);
+        part.empty_result_count = bucket.empty_result_count.load(memory_order_relaxed);
+        part.result_count = bucket.result_count.load(memory_order_relaxed);
+        part.posting_count = bucket.posting_count.load(memory_order_relaxed);
+        part.total_latency = Clock::duration(bucket.total_latency.load(memory_order_relaxed));
+        for (size_t i = 0; i < LATENCY_BUCKET_COUNT; ++i) {
+            part.latency_histogram[i] = bucket.latency_histogram[i].load(memory_order_relaxed);
+        }
+        atomic_thread_fence(memory_order_acquire);
+        if (bucket.epoch.load(memory_order_relaxed) != epoch) {
+            continue;
+        }
+        snapshot.request_count += part.request_count;
+        snapshot.empty_result_count += part.empty_result_count;
+        snapshot.result_count += part.result_count;
+        snapshot.posting_count += part.posting_count;
+        snapshot.total_latency += part.total_latency;
+        for (size_t i = 0; i < LATENCY_BUCKET_COUNT; ++i) {
+            snapshot.latency_histogram[i] += part.latency_histogram[i];
+        }
+    }
+    return snapshot;
+}
+
+int64_t RequestStatistics::GetEpoch(Clock::time_point time) const {
+    return time.time_since_epoch() / bucket_width_;
+}
+
+RequestStatistics::Bucket* RequestStatistics::AcquireBucket(int64_t epoch) {
+    Bucket& bucket = buckets_[static_cast<size_t>(epoch) % buckets_.size()];
+    for (;;) {
+        int64_t current = bucket.epoch.load(memory_order_acquire);
+        if (current == epoch) {
+            return &bucket;
+        }
+        // Ожидание обнуления превратило бы ячейку в спин-блокировку: вытесненный на середине
+        // обнуления поток останавливал бы всех писателей. Запрос, пришедший в эти несколько
+        // записей на границе интервала, не учитывается.
+        if (current == RESETTING_EPOCH || current > epoch) {
+            return nullptr;
+        }
+        // Обнуляет ячейку тот поток, который первым застал в ней прошлый интервал.
+        if (bucket.epoch.compare_exchange_weak(current, RESETTING_EPOCH, memory_order_acquire)) {
+            atomic_thread_fence(memory_order_release);
+            bucket.request_count.store(0, memory_order_relaxed);
+            bucket.empty_result_count.store(0, memory_order_relaxed);
+            bucket.result_count.store(0, memory_order_relaxed);
+            bucket.posting_count.store(0, memory_order_relaxed);
+            bucket.total_latency.store(0, memory_order_relaxed);
+            for (auto& count : bucket.latency_histogram) {
+                count.store(0, memory_order_relaxed);
+            }
+            bucket.epoch.store(epoch, memory_order_release);
+            return &bucket;
+        }
+    }
+}
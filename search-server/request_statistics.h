@@ -0,0 +1,64 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Статистика поисковых запросов за скользящие окна времени. Время делится на интервалы
+// bucket_width, счётчики каждого интервала лежат в кольце из bucket_count ячеек атомиков,
+// поэтому Record и GetSnapshot можно вызывать из любого числа потоков без блокировок и ожидания.
+// Текст запросов не хранится.
+class RequestStatistics {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // Интервал i гистограммы задержек: [2^(i-1), 2^i) микросекунд, нулевой — меньше микросекунды.
+    static constexpr size_t LATENCY_BUCKET_COUNT = 32;
+
+    struct Snapshot {
+        uint64_t request_count = 0;
+        uint64_t empty_result_count = 0;
+        uint64_t result_count = 0;
+        // Суммарная длина списков вхождений слов запросов.
+        uint64_t posting_count = 0;
+        Clock::duration total_latency{};
+        std::array<uint64_t, LATENCY_BUCKET_COUNT> latency_histogram{};
+
+        double GetEmptyResultRate() const;
+        // Верхняя граница интервала гистограммы, в который попадает квантиль quantile.
+        std::chrono::microseconds GetLatencyQuantile(double quantile) const;
+    };
+
+    explicit RequestStatistics(Clock::duration bucket_width = std::chrono::seconds(10), size_t bucket_count = 360);
+
+    // Запрос, записанный в тот момент, когда другой поток обнуляет ячейку нового интервала, теряется.
+    void Record(Clock::duration latency, size_t result_count, uint64_t posting_count, Clock::time_point now = Clock::now());
+
+    // Сумма по интервалам, пересекающимся с последним window; окно длиннее истории
+    // обрезается до неё. Интервал, который в этот момент переиспользуется, пропускается.
+    Snapshot GetSnapshot(Clock::duration window, Clock::time_point now = Clock::now()) const;
+
+private:
+    struct Bucket {
+        std::atomic<int64_t> epoch{EMPTY_EPOCH};
+        std::atomic<uint64_t> request_count{0};
+        std::atomic<uint64_t> empty_result_count{0};
+        std::atomic<uint64_t> result_count{0};
+        std::atomic<uint64_t> posting_count{0};
+        std::atomic<int64_t> total_latency{0};
+        std::array<std::atomic<uint64_t>, LATENCY_BUCKET_COUNT> latency_histogram{};
+    };
+
+    static constexpr int64_t EMPTY_EPOCH = -1;
+    static constexpr int64_t RESETTING_EPOCH = -2;
+
+    int64_t GetEpoch(Clock::time_point time) const;
+    // Ячейка интервала epoch; nullptr, если её уже занял более поздний интервал или её обнуляет другой поток.
+    Bucket* AcquireBucket(int64_t epoch);
+
+    Clock::duration bucket_width_;
+    std::vector<Bucket> buckets_;
+};
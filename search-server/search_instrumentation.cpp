@@ -0,0 +1,106 @@
+#include "search_instrumentation.h"
+
+#include <atomic>
+#include <ostream>
+
+using namespace std;
+
+namespace {
+
+struct StageTotals {
+    atomic<uint64_t> calls{0};
+    atomic<int64_t> total_duration{0};
+    atomic<int64_t> max_duration{0};
+};
+
+array<StageTotals, SEARCH_STAGE_COUNT> stage_totals;
+array<atomic<uint64_t>, SEARCH_COUNTER_COUNT> counter_totals{};
+atomic<SearchInstrumentation::TraceHook> trace_hook{nullptr};
+
+}  // namespace
+
+string_view GetSearchStageName(SearchStage stage) {
+    switch (stage) {
+        case SearchStage::PARSE: return "parse";
+        case SearchStage::RESOLVE: return "resolve";
+        case SearchStage::TRAVERSE: return "traverse";
+        case SearchStage::MINUS_FILTER: return "minus_filter";
+        case SearchStage::SELECT: return "select";
+        case SearchStage::MATCH: return "match";
+        case SearchStage::MERGE: return "merge";
+    }
+    return "unknown";
+}
+
+string_view GetSearchCounterName(SearchCounter counter) {
+    switch (counter) {
+        case SearchCounter::POSTINGS_VISITED: return "postings_visited";
+        case SearchCounter::CANDIDATES_SCORED: return "candidates_scored";
+        case SearchCounter::MINUS_WORD_EXCLUSIONS: return "minus_word_exclusions";
+    }
+    return "unknown";
+}
+
+ostream& operator<<(ostream& output, const InstrumentationSnapshot& snapshot) {
+    output << "{\"benchmark\": \"instrumentation\"";
+    for (size_t i = 0; i < SEARCH_STAGE_COUNT; ++i) {
+        const auto& stage = snapshot.stages[i];
+        const string_view name = GetSearchStageName(static_cast<SearchStage>(i));
+        output << ", \"" << name << "_calls\": " << stage.calls
+               << ", \"" << name << "_total_us\": " << stage.total_duration.count() / 1000.0
+               << ", \"" << name << "_max_us\": " << stage.max_duration.count() / 1000.0;
+    }
+    for (size_t i = 0; i < SEARCH_COUNTER_COUNT; ++i) {
+        output << ", \"" << GetSearchCounterName(static_cast<SearchCounter>(i)) << "\": " << snapshot.counters[i];
+    }
+    return output << "}";
+}
+
+void SearchInstrumentation::RecordStage(SearchStage stage, chrono::nanoseconds duration) {
+    StageTotals& totals = stage_totals[static_cast<size_t>(stage)];
+    totals.calls.fetch_add(1, memory_order_relaxed);
+    totals.total_duration.fetch_add(duration.count(), memory_order_relaxed);
+    int64_t max_duration = totals.max_duration.load(memory_order_relaxed);
+    while (max_duration < duration.count()
+           && !totals.max_duration.compare_exchange_weak(max_duration, duration.count(), memory_order_relaxed)) {
+    }
+    if (const TraceHook hook = trace_hook.load(memory_order_acquire)) {
+        hook(stage, duration);
+    }
+}
+
+void SearchInstrumentation::AddCounters(const array<uint64_t, SEARCH_COUNTER_COUNT>& counters) {
+    for (size_t i = 0; i < SEARCH_COUNTER_COUNT; ++i) {
+        if (counters[i] != 0) {
+            counter_totals[i].fetch_add(counters[i], memory_order_relaxed);
+        }
+    }
+}
+
+InstrumentationSnapshot SearchInstrumentation::GetSnapshot() {
+    InstrumentationSnapshot snapshot;
+    for (size_t i = 0; i < SEARCH_STAGE_COUNT; ++i) {
+        snapshot.stages[i].calls = stage_totals[i].calls.load(memory_order_relaxed);
+        snapshot.stages[i].total_duration = chrono::nanoseconds(stage_totals[i].total_duration.load(memory_order_relaxed));
+        snapshot.stages[i].max_duration = chrono::nanoseconds(stage_totals[i].max_duration.load(memory_order_relaxed));
+    }
+    for (size_t i = 0; i < SEARCH_COUNTER_COUNT; ++i) {
+        snapshot.counters[i] = counter_totals[i].load(memory_order_relaxed);
+    }
+    return snapshot;
+}
+
+void SearchInstrumentation::Reset() {
+    for (StageTotals& totals : stage_totals) {
+        totals.calls.store(0, memory_order_relaxed);
+        totals.total_duration.store(0, memory_order_relaxed);
+        totals.max_duration.store(0, memory_order_relaxed);
+    }
+    for (auto& total : counter_totals) {
+        total.store(0, memory_order_relaxed);
+    }
+}
+
+void SearchInstrumentation::SetTraceHook(TraceHook hook) {
+    trace_hook.store(hook, memory_order_release);
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string_view>
+
+// Замеры стадий поиска и счётчики работы запросов. Собираются, только если определён
+// SEARCH_SERVER_INSTRUMENTATION (опция CMake с тем же именем); иначе таймеры и счётчики
+// превращаются в пустые классы и не стоят ничего.
+#ifdef SEARCH_SERVER_INSTRUMENTATION
+constexpr bool INSTRUMENTATION_ENABLED = true;
+#else
+constexpr bool INSTRUMENTATION_ENABLED = false;
+#endif
+
+enum class SearchStage {
+    PARSE,
+    // Поиск термов запроса в словаре и расчёт IDF.
+    RESOLVE,
+    // Обход списков вхождений и подсчёт релевантности.
+    TRAVERSE,
+    // Исключение документов с минус-словами при полном переборе; входит в TRAVERSE.
+    // WAND и пересечение списков проверяют минус-слова у каждого кандидата отдельно:
+    // там это время не выделяется из TRAVERSE, а исключения видны только по MINUS_WORD_EXCLUSIONS.
+    MINUS_FILTER,
+    // Сортировка и отбор лучших документов; при параллельном поиске замеряется в каждом шарде.
+    SELECT,
+    MATCH,
+    // Слияние выдач шардов параллельного поиска в общую.
+    MERGE,
+};
+
+const size_t SEARCH_STAGE_COUNT = 7;
+
+enum class SearchCounter {
+    POSTINGS_VISITED,
+    CANDIDATES_SCORED,
+    // Документы, отброшенные минус-словами после того, как прошли предикат.
+    MINUS_WORD_EXCLUSIONS,
+};
+
+const size_t SEARCH_COUNTER_COUNT = 3;
+
+std::string_view GetSearchStageName(SearchStage stage);
+std::string_view GetSearchCounterName(SearchCounter counter);
+
+struct InstrumentationSnapshot {
+    struct Stage {
+        uint64_t calls = 0;
+        std::chrono::nanoseconds total_duration{};
+        std::chrono::nanoseconds max_duration{};
+    };
+
+    std::array<Stage, SEARCH_STAGE_COUNT> stages{};
+    std::array<uint64_t, SEARCH_COUNTER_COUNT> counters{};
+};
+
+// Снимок одной строкой JSON, в том же виде, что и вывод бенчмарка.
+std::ostream& operator<<(std::ostream& output, const InstrumentationSnapshot& snapshot);
+
+// Общие для процесса накопители; методы можно вызывать из любых потоков.
+class SearchInstrumentation {
+public:
+    // Вызывается по окончании каждой замеренной стадии в потоке, где она выполнялась.
+    using TraceHook = void (*)(SearchStage stage, std::chrono::nanoseconds duration);
+
+    static void RecordStage(SearchStage stage, std::chrono::nanoseconds duration);
+    static void AddCounters(const std::array<uint64_t, SEARCH_COUNTER_COUNT>& counters);
+    static InstrumentationSnapshot GetSnapshot();
+    static void Reset();
+    static void SetTraceHook(TraceHook hook);
+};
+
+// Замеряет время от создания до конца области видимости.
+template <bool Enabled>
+class BasicStageTimer {
+public:
+    explicit BasicStageTimer(SearchStage stage)
+        : stage_(stage)
+        , start_(std::chrono::steady_clock::now()) {
+    }
+
+    BasicStageTimer(const BasicStageTimer&) = delete;
+    BasicStageTimer& operator=(const BasicStageTimer&) = delete;
+
+    ~BasicStageTimer() {
+        SearchInstrumentation::RecordStage(stage_, std::chrono::steady_clock::now() - start_);
+    }
+
+private:
+    SearchStage stage_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+template <>
+class BasicStageTimer<false> {
+public:
+    explicit BasicStageTimer(SearchStage) {
+    }
+};
+
+// Счётчики одного обхода: копятся без синхронизации и сбрасываются в общие при разрушении.
+template <bool Enabled>
+class BasicQueryCounters {
+public:
+    BasicQueryCounters() = default;
+    BasicQueryCounters(const BasicQueryCounters&) = delete;
+    BasicQueryCounters& operator=(const BasicQueryCounters&) = delete;
+
+    ~BasicQueryCounters() {
+        SearchInstrumentation::AddCounters(values_);
+    }
+
+    void Add(SearchCounter counter, uint64_t value = 1) {
+        values_[static_cast<size_t>(counter)] += value;
+    }
+
+private:
+    std::array<uint64_t, SEARCH_COUNTER_COUNT> values_{};
+};
+
+template <>
+class BasicQueryCounters<false> {
+public:
+    void Add(SearchCounter, uint64_t = 1) {
+    }
+};
+
+using StageTimer = BasicStageTimer<INSTRUMENTATION_ENABLED>;
+using QueryCounters = BasicQueryCounters<INSTRUMENTATION_ENABLED>;
@@ -1,82 +1,694 @@
 #include "search_server.h"
 
+#include "snapshot.h"
+
+#include <bitset>
 #include <cmath>
+#include <exception>
+#include <unordered_set>
 
 using namespace std;
 
 
 
 SearchServer::SearchServer(const string& stop_words_text)
+        : SearchServer(string_view(stop_words_text)){
+    }
+
+SearchServer::SearchServer(string_view stop_words_text)
         : SearchServer(SplitIntoWords(stop_words_text)){
     }
 
-void SearchServer::AddDocument(int document_id, const string& document, DocumentStatus status, const vector<int>& ratings) {
+void SearchServer::AddDocument(int document_id, string_view document, DocumentStatus status, const vector<int>& ratings) {
+    if(document_id_to_index_.count(document_id)){
+        throw invalid_argument("attempt to add a document with the id of a previously added document"s);
+    }
+    AddPreparedDocument(PrepareDocument(document_id, document, status, ratings));
+}
+
+PreparedDocument SearchServer::PrepareDocument(int document_id, string_view document, DocumentStatus status,
+                                               const vector<int>& ratings) const {
     if(document_id < 0){
         throw invalid_argument("attempt to add a document with a negative id"s);
     }
-        
-    if(documents_.count(document_id)){
+
+    const vector<string_view> words = SplitIntoWordsNoStop(document);
+    const double inv_word_count = 1.0 / words.size();
+    vector<pair<string_view, int>> occurrences;
+    occurrences.reserve(words.size());
+    for (size_t position = 0; position < words.size(); ++position) {
+        occurrences.emplace_back(words[position], static_cast<int>(position));
+    }
+    sort(occurrences.begin(), occurrences.end());
+
+    PreparedDocument prepared;
+    prepared.id = document_id;
+    prepared.rating = ComputeAverageRating(ratings);
+    prepared.status = status;
+    prepared.positions.reserve(occurrences.size());
+    prepared.position_offsets.push_back(0);
+    for (size_t i = 0; i < occurrences.size(); ++i) {
+        if (i == 0 || occurrences[i].first != occurrences[i - 1].first) {
+            if (i > 0) {
+                prepared.position_offsets.push_back(static_cast<int>(i));
+            }
+            prepared.word_freqs.emplace_back(occurrences[i].first, 0.0);
+        }
+        prepared.word_freqs.back().second += inv_word_count;
+        prepared.positions.push_back(occurrences[i].second);
+    }
+    prepared.position_offsets.push_back(static_cast<int>(occurrences.size()));
+    return prepared;
+}
+
+void SearchServer::AddPreparedDocument(const PreparedDocument& document) {
+    if(document_id_to_index_.count(document.id)){
         throw invalid_argument("attempt to add a document with the id of a previously added document"s);
     }
-        
-    const vector<string> words = SplitIntoWordsNoStop(document);
-    const double inv_word_count = 1.0 / words.size();
-    for (const string& word : words) {
-        word_to_document_freqs_[word][document_id] += inv_word_count;
+
+    vector<TermId> word_term_ids;
+    word_term_ids.reserve(document.word_freqs.size());
+    for (const auto& [word, term_freq] : document.word_freqs) {
+        word_term_ids.push_back(index_.InternTerm(word));
+    }
+
+    const int document_index = static_cast<int>(documents_.size());
+    DocumentData document_data{document.id, document.rating, document.status};
+    FillForwardIndex(document_data, document, word_term_ids);
+    for (size_t i = 0; i < document_data.term_ids.size(); ++i) {
+        index_.AddPosting(document_data.term_ids[i], document_index, document_data.term_freqs[i]);
     }
     
-    documents_.emplace(document_id, DocumentData{ComputeAverageRating(ratings), status});  
-    documents_id_.push_back(document_id);
+    total_word_count_ += document_data.word_count;
+    documents_.push_back(move(document_data));
+    SetStatusBit(document_index, document.status);
+    document_id_to_index_.emplace(document.id, document_index);
+    document_ids_.insert(document.id);
+    GrowInverseDocumentFreqCache();
+    ++generation_;
 }
 
 
 
-vector<Document> SearchServer::FindTopDocuments(const string& raw_query) const {
-    return FindTopDocuments(raw_query, [](int document_id, DocumentStatus status, int rating){ return status == DocumentStatus::ACTUAL; });
+vector<Document> SearchServer::FindTopDocuments(string_view raw_query) const {
+    return FindTopDocuments(raw_query, DocumentStatusSet(DocumentStatus::ACTUAL));
     }
     
-vector<Document> SearchServer::FindTopDocuments(const string& raw_query, const DocumentStatus& status) const {
-    return FindTopDocuments(raw_query, [&status](int document_id, DocumentStatus document_status, int rating) {return document_status == status;});
+vector<Document> SearchServer::FindTopDocuments(string_view raw_query, const DocumentStatus& status) const {
+    return FindTopDocuments(raw_query, DocumentStatusSet(status));
+    }
+
+void SearchServer::AddDocuments(const vector<RawDocument>& documents) {
+    unordered_set<int> batch_ids;
+    for (const RawDocument& document : documents) {
+        if (document.id < 0) {
+            throw invalid_argument("attempt to add a document with a negative id"s);
+        }
+        if (document_id_to_index_.count(document.id) || !batch_ids.insert(document.id).second) {
+            throw invalid_argument("attempt to add a document with the id of a previously added document"s);
+        }
     }
 
+    const int batch_size = static_cast<int>(documents.size());
+    const int chunk_count = min(batch_size, static_cast<int>(max(1u, thread::hardware_concurrency()) * 4));
+    if (chunk_count == 0) {
+        return;
+    }
+    const int chunk_width = (batch_size - 1) / chunk_count + 1;
+    const int first_document_index = static_cast<int>(documents_.size());
+
+    // Частичный индекс диапазона пакета: слова в порядке первого появления и их вхождения.
+    struct PartialIndex {
+        unordered_map<string_view, size_t> word_to_slot;
+        vector<string_view> words;
+        vector<TermId> term_ids;
+        vector<vector<int>> document_indexes;
+        vector<vector<double>> term_freqs;
+    };
+
+    vector<PreparedDocument> prepared(batch_size);
+    vector<exception_ptr> errors(batch_size);
+    vector<PartialIndex> partials(chunk_count);
+    vector<int> chunk_indexes(chunk_count);
+    for (int i = 0; i < chunk_count; ++i) {
+        chunk_indexes[i] = i;
+    }
+
+    for_each(execution::par, chunk_indexes.begin(), chunk_indexes.end(), [&](int chunk_index) {
+        PartialIndex& partial = partials[chunk_index];
+        const int last = min((chunk_index + 1) * chunk_width, batch_size);
+        for (int i = chunk_index * chunk_width; i < last; ++i) {
+            try {
+                const RawDocument& document = documents[i];
+                prepared[i] = PrepareDocument(document.id, document.text, document.status, document.ratings);
+            } catch (...) {
+                errors[i] = current_exception();
+                continue;
+            }
+            for (const auto& [word, term_freq] : prepared[i].word_freqs) {
+                const auto [it, inserted] = partial.word_to_slot.emplace(word, partial.words.size());
+                if (inserted) {
+                    partial.words.push_back(word);
+                    partial.document_indexes.emplace_back();
+                    partial.term_freqs.emplace_back();
+                }
+                partial.document_indexes[it->second].push_back(first_document_index + i);
+                partial.term_freqs[it->second].push_back(term_freq);
+            }
+        }
+    });
+    for (const exception_ptr& error : errors) {
+        if (error) {
+            rethrow_exception(error);
+        }
+    }
+
+    // Словарь термов общий, поэтому новые термы заводятся последовательно.
+    vector<vector<pair<int, size_t>>> term_to_slots;
+    for (int chunk_index = 0; chunk_index < chunk_count; ++chunk_index) {
+        PartialIndex& partial = partials[chunk_index];
+        partial.term_ids.reserve(partial.words.size());
+        for (size_t slot = 0; slot < partial.words.size(); ++slot) {
+            const TermId term_id = index_.InternTerm(partial.words[slot]);
+            partial.term_ids.push_back(term_id);
+            if (term_to_slots.size() <= static_cast<size_t>(term_id)) {
+                term_to_slots.resize(term_id + 1);
+            }
+            term_to_slots[term_id].emplace_back(chunk_index, slot);
+        }
+    }
+
+    vector<TermId> touched_terms;
+    for (TermId term_id = 0; term_id < static_cast<TermId>(term_to_slots.size()); ++term_id) {
+        if (!term_to_slots[term_id].empty()) {
+            touched_terms.push_back(term_id);
+        }
+    }
+    for_each(execution::par, touched_terms.begin(), touched_terms.end(), [&](TermId term_id) {
+        for (const auto& [chunk_index, slot] : term_to_slots[term_id]) {
+            index_.AppendPostings(term_id, partials[chunk_index].document_indexes[slot], partials[chunk_index].term_freqs[slot]);
+        }
+    });
+
+    vector<DocumentData> new_documents(batch_size);
+    for_each(execution::par, chunk_indexes.begin(), chunk_indexes.end(), [&](int chunk_index) {
+        const PartialIndex& partial = partials[chunk_index];
+        const int last = min((chunk_index + 1) * chunk_width, batch_size);
+        vector<TermId> word_term_ids;
+        for (int i = chunk_index * chunk_width; i < last; ++i) {
+            word_term_ids.clear();
+            for (const auto& [word, term_freq] : prepared[i].word_freqs) {
+                word_term_ids.push_back(partial.term_ids[partial.word_to_slot.at(word)]);
+            }
+            DocumentData& document_data = new_documents[i];
+            document_data = {prepared[i].id, prepared[i].rating, prepared[i].status};
+            FillForwardIndex(document_data, prepared[i], word_term_ids);
+        }
+    });
+
+    documents_.reserve(documents_.size() + batch_size);
+    for (int i = 0; i < batch_size; ++i) {
+        document_id_to_index_.emplace(new_documents[i].id, first_document_index + i);
+        document_ids_.insert(new_documents[i].id);
+        total_word_count_ += new_documents[i].word_count;
+        SetStatusBit(first_document_index + i, new_documents[i].status);
+        documents_.push_back(move(new_documents[i]));
+    }
+    GrowInverseDocumentFreqCache();
+    ++generation_;
+}
+
+void SearchServer::CompactIndex() {
+    if (documents_.size() != document_ids_.size()) {
+        RemoveDeletedDocuments();
+    } else {
+        index_.CompactPostings();
+    }
+}
+
+void SearchServer::RemoveDeletedDocuments() {
+    vector<int> new_indexes(documents_.size(), -1);
+    vector<DocumentData> live_documents;
+    live_documents.reserve(document_ids_.size());
+    for (size_t i = 0; i < documents_.size(); ++i) {
+        if (documents_[i].is_alive) {
+            new_indexes[i] = static_cast<int>(live_documents.size());
+            live_documents.push_back(move(documents_[i]));
+        }
+    }
+    index_.RenumberDocuments(new_indexes);
+    documents_ = move(live_documents);
+
+    for (auto& bitmap : status_bitmaps_) {
+        bitmap.clear();
+    }
+    status_counts_.fill(0);
+    for (size_t i = 0; i < documents_.size(); ++i) {
+        document_id_to_index_[documents_[i].id] = static_cast<int>(i);
+        SetStatusBit(static_cast<int>(i), documents_[i].status);
+    }
+    ++generation_;
+}
+
+void SearchServer::AddDocumentCopy(const SearchServer& source, int document_id) {
+    if(document_id_to_index_.count(document_id)){
+        throw invalid_argument("attempt to add a document with the id of a previously added document"s);
+    }
+    const DocumentData& source_data = source.documents_[source.document_id_to_index_.at(document_id)];
+
+    vector<pair<TermId, size_t>> term_slots;
+    term_slots.reserve(source_data.term_ids.size());
+    for (size_t i = 0; i < source_data.term_ids.size(); ++i) {
+        term_slots.emplace_back(index_.InternTerm(source.index_.GetTerm(source_data.term_ids[i])), i);
+    }
+    sort(term_slots.begin(), term_slots.end());
+
+    const int document_index = static_cast<int>(documents_.size());
+    DocumentData document_data{document_id, source_data.rating, source_data.status};
+    document_data.term_ids.reserve(term_slots.size());
+    document_data.term_freqs.reserve(term_slots.size());
+    document_data.position_offsets.reserve(term_slots.size() + 1);
+    document_data.positions.reserve(source_data.positions.size());
+    document_data.position_offsets.push_back(0);
+    for (const auto& [term_id, slot] : term_slots) {
+        index_.AddPosting(term_id, document_index, source_data.term_freqs[slot]);
+        document_data.term_ids.push_back(term_id);
+        document_data.term_freqs.push_back(source_data.term_freqs[slot]);
+        document_data.positions.insert(document_data.positions.end(),
+                                       source_data.positions.begin() + source_data.position_offsets[slot],
+                                       source_data.positions.begin() + source_data.position_offsets[slot + 1]);
+        document_data.position_offsets.push_back(static_cast<int>(document_data.positions.size()));
+    }
+    document_data.word_count = source_data.word_count;
+
+    total_word_count_ += document_data.word_count;
+    documents_.push_back(move(document_data));
+    SetStatusBit(document_index, source_data.status);
+    document_id_to_index_.emplace(document_id, document_index);
+    document_ids_.insert(document_id);
+    GrowInverseDocumentFreqCache();
+    ++generation_;
+}
+
+CorpusStatistics SearchServer::GetCorpusStatistics(string_view raw_query) const {
+    CorpusStatistics statistics;
+    statistics.document_count = GetDocumentCount();
+    statistics.word_count = total_word_count_;
+    for (const string_view word : ParseQuery(raw_query).plus_words) {
+        const TermId term_id = index_.FindTerm(word);
+        if (term_id != InvertedIndex::NO_TERM && !index_.GetPostings(term_id).empty()) {
+            statistics.document_freqs.emplace(word, static_cast<int>(index_.GetPostings(term_id).size()));
+        }
+    }
+    return statistics;
+}
+
+void CorpusStatistics::Merge(const CorpusStatistics& other) {
+    document_count += other.document_count;
+    word_count += other.word_count;
+    for (const auto& [word, document_freq] : other.document_freqs) {
+        document_freqs[word] += document_freq;
+    }
+}
+
 int SearchServer::GetDocumentCount() const {
-        return documents_.size();
+        return document_ids_.size();
+    }
+
+int SearchServer::GetDocumentCount(DocumentStatusSet statuses) const {
+    int count = 0;
+    for (int status = 0; status < DOCUMENT_STATUS_COUNT; ++status) {
+        if (statuses.Contains(static_cast<DocumentStatus>(status))) {
+            count += status_counts_[status];
+        }
+    }
+    return count;
+}
+
+void SearchServer::SetStatusBit(int document_index, DocumentStatus status) {
+    const size_t word_count = static_cast<size_t>(document_index) / 64 + 1;
+    for (auto& bitmap : status_bitmaps_) {
+        if (bitmap.size() < word_count) {
+            bitmap.resize(max(word_count, bitmap.size() * 2));
+        }
+    }
+    status_bitmaps_[static_cast<int>(status)][document_index / 64] |= uint64_t(1) << (document_index % 64);
+    ++status_counts_[static_cast<int>(status)];
+}
+
+void SearchServer::ClearStatusBit(int document_index, DocumentStatus status) {
+    status_bitmaps_[static_cast<int>(status)][document_index / 64] &= ~(uint64_t(1) << (document_index % 64));
+    --status_counts_[static_cast<int>(status)];
+}
+
+uint64_t SearchServer::GetStatusWord(DocumentStatusSet statuses, size_t word_index) const {
+    uint64_t word = 0;
+    for (int status = 0; status < DOCUMENT_STATUS_COUNT; ++status) {
+        if (statuses.Contains(static_cast<DocumentStatus>(status))) {
+            word |= status_bitmaps_[status][word_index];
+        }
+    }
+    return word;
+}
+
+int SearchServer::FindNextDocument(DocumentStatusSet statuses, int document_index, int last_index) const {
+    if (document_index >= last_index) {
+        return last_index;
+    }
+    size_t word_index = static_cast<size_t>(document_index) / 64;
+    // Биты документов левее document_index в первом слове сбрасываются.
+    uint64_t word = GetStatusWord(statuses, word_index) & (~uint64_t(0) << (document_index % 64));
+    const size_t last_word_index = static_cast<size_t>(last_index - 1) / 64;
+    while (word == 0) {
+        if (++word_index > last_word_index) {
+            return last_index;
+        }
+        word = GetStatusWord(statuses, word_index);
+    }
+#ifdef __GNUC__
+    const int bit = __builtin_ctzll(word);
+#else
+    int bit = 0;
+    while (((word >> bit) & 1) == 0) {
+        ++bit;
+    }
+#endif
+    return min(static_cast<int>(word_index * 64) + bit, last_index);
+}
+
+uint64_t SearchServer::GetGeneration() const {
+    return generation_;
+}
+
+size_t SearchServer::GetIndexMemoryUsage() const {
+    return index_.GetPostingsMemoryUsage();
+}
+
+uint64_t SearchServer::GetQueryPostingCount(string_view raw_query) const {
+    return GetQueryPostingCount(ParseQuery(raw_query));
+}
+
+uint64_t SearchServer::GetQueryPostingCount(const Query& query) const {
+    uint64_t posting_count = 0;
+    for (const auto* words : {&query.plus_words, &query.minus_words}) {
+        for (const string_view word : *words) {
+            const TermId term_id = index_.FindTerm(word);
+            if (term_id != InvertedIndex::NO_TERM) {
+                posting_count += index_.GetPostings(term_id).size();
+            }
+        }
+    }
+    return posting_count;
+}
+
+int SearchServer::GetDocumentWordCount(int document_id) const {
+    const auto index_it = document_id_to_index_.find(document_id);
+    return index_it == document_id_to_index_.end() ? 0 : documents_[index_it->second].word_count;
+}
+
+string SearchServer::NormalizeQuery(string_view raw_query) const {
+    return NormalizeQuery(ParseQuery(raw_query));
+}
+
+string SearchServer::NormalizeQuery(const Query& query) const {
+    string normalized;
+    for (const string_view word : query.plus_words) {
+        normalized += word;
+        normalized += ' ';
+    }
+    for (const string_view word : query.minus_words) {
+        normalized += '-';
+        normalized += word;
+        normalized += ' ';
+    }
+    for (const auto& phrase : query.phrases) {
+        normalized += '"';
+        for (const string_view word : phrase) {
+            normalized += word;
+            normalized += ' ';
+        }
+        normalized += "\" "s;
+    }
+    return normalized;
+}
+
+set<int>::const_iterator SearchServer::begin() const {
+    return document_ids_.begin();
+}
+
+set<int>::const_iterator SearchServer::end() const {
+    return document_ids_.end();
+}
+
+map<string_view, double> SearchServer::GetWordFrequencies(int document_id) const {
+    map<string_view, double> word_frequencies;
+    const auto index_it = document_id_to_index_.find(document_id);
+    if (index_it == document_id_to_index_.end()) {
+        return word_frequencies;
+    }
+    const DocumentData& document_data = documents_[index_it->second];
+    for (size_t i = 0; i < document_data.term_ids.size(); ++i) {
+        word_frequencies.emplace(index_.GetTerm(document_data.term_ids[i]), document_data.term_freqs[i]);
     }
+    return word_frequencies;
+}
+
+const vector<TermId>& SearchServer::GetDocumentTermIds(int document_id) const {
+    static const vector<TermId> empty_term_ids;
+    const auto index_it = document_id_to_index_.find(document_id);
+    if (index_it == document_id_to_index_.end()) {
+        return empty_term_ids;
+    }
+    return documents_[index_it->second].term_ids;
+}
+
+void SearchServer::RemoveDocument(int document_id) {
+    RemoveDocumentImpl(execution::seq, document_id);
+}
+
+void SearchServer::RemoveDocument(const execution::sequenced_policy& policy, int document_id) {
+    RemoveDocumentImpl(policy, document_id);
+}
 
-tuple<vector<string>, DocumentStatus> SearchServer::MatchDocument(const string& raw_query, int document_id) const {
+void SearchServer::RemoveDocument(const execution::parallel_policy& policy, int document_id) {
+    RemoveDocumentImpl(policy, document_id);
+}
+
+tuple<vector<string_view>, DocumentStatus> SearchServer::MatchDocument(string_view raw_query, int document_id) const {
+        return MatchDocument(execution::seq, raw_query, document_id);
+    }
+
+tuple<vector<string_view>, DocumentStatus> SearchServer::MatchDocument(const execution::sequenced_policy&,
+                                                                      string_view raw_query, int document_id) const {
+        StageTimer timer(SearchStage::MATCH);
+        const DocumentData& document_data = documents_[document_id_to_index_.at(document_id)];
         const Query query = ParseQuery(raw_query);
-        vector<string> matched_words;
-        for (const string& word : query.plus_words) {
-            if (word_to_document_freqs_.count(word) == 0) {
-                continue;
+        for (const string_view word : query.minus_words) {
+            if (!FindDocumentWord(document_data, word).empty()) {
+                return {vector<string_view>{}, document_data.status};
             }
-            if (word_to_document_freqs_.at(word).count(document_id)) {
-                matched_words.push_back(word);
+        }
+        for (const auto& phrase : query.phrases) {
+            if (!ContainsPhrase(document_data, ResolvePhrase(phrase))) {
+                return {vector<string_view>{}, document_data.status};
             }
         }
-        for (const string& word : query.minus_words) {
-            if (word_to_document_freqs_.count(word) == 0) {
-                continue;
+
+        vector<string_view> matched_words;
+        for (const string_view word : query.plus_words) {
+            const string_view document_word = FindDocumentWord(document_data, word);
+            if (!document_word.empty()) {
+                matched_words.push_back(document_word);
             }
-            if (word_to_document_freqs_.at(word).count(document_id)) {
-                matched_words.clear();
-                break;
+        }
+        return {matched_words, document_data.status};
+    }
+
+tuple<vector<string_view>, DocumentStatus> SearchServer::MatchDocument(const execution::parallel_policy&,
+                                                                      string_view raw_query, int document_id) const {
+        StageTimer timer(SearchStage::MATCH);
+        const DocumentData& document_data = documents_[document_id_to_index_.at(document_id)];
+        const Query query = ParseQuery(raw_query, false);
+        const bool has_minus_word = any_of(execution::par, query.minus_words.begin(), query.minus_words.end(),
+                                           [this, &document_data](string_view word) {
+                                               return !FindDocumentWord(document_data, word).empty();
+                                           });
+        const bool has_missing_phrase = any_of(query.phrases.begin(), query.phrases.end(), [this, &document_data](const auto& phrase) {
+            return !ContainsPhrase(document_data, ResolvePhrase(phrase));
+        });
+        if (has_minus_word || has_missing_phrase) {
+            return {vector<string_view>{}, document_data.status};
+        }
+
+        vector<string_view> matched_words(query.plus_words.size());
+        transform(execution::par, query.plus_words.begin(), query.plus_words.end(), matched_words.begin(),
+                  [this, &document_data](string_view word) {
+                      return FindDocumentWord(document_data, word);
+                  });
+        sort(execution::par, matched_words.begin(), matched_words.end());
+        matched_words.erase(unique(matched_words.begin(), matched_words.end()), matched_words.end());
+        if (!matched_words.empty() && matched_words.front().empty()) {
+            matched_words.erase(matched_words.begin());
+        }
+        return {matched_words, document_data.status};
+    }
+
+void SearchServer::SaveSnapshot(const string& path) const {
+    SnapshotWriter writer(path);
+    writer.Write(static_cast<uint64_t>(stop_words_.size()));
+    for (const string& stop_word : stop_words_) {
+        writer.WriteString(stop_word);
+    }
+
+    vector<int> snapshot_indexes(documents_.size(), -1);
+    int snapshot_index = 0;
+    writer.Write(static_cast<uint64_t>(GetDocumentCount()));
+    for (size_t i = 0; i < documents_.size(); ++i) {
+        const DocumentData& document_data = documents_[i];
+        if (!document_data.is_alive) {
+            continue;
+        }
+        snapshot_indexes[i] = snapshot_index++;
+        writer.Write(static_cast<int32_t>(document_data.id));
+        writer.Write(static_cast<int32_t>(document_data.rating));
+        writer.Write(static_cast<int32_t>(document_data.status));
+    }
+    const bool has_removed = snapshot_index != static_cast<int>(documents_.size());
+
+    writer.Write(static_cast<uint64_t>(index_.GetTermCount()));
+    vector<int> document_indexes;
+    vector<double> term_freqs;
+    for (TermId term_id = 0; term_id < static_cast<TermId>(index_.GetTermCount()); ++term_id) {
+        const PostingList& postings = index_.GetPostings(term_id);
+        writer.WriteString(index_.GetTerm(term_id));
+        writer.Write(static_cast<uint64_t>(postings.size()));
+        writer.Write(postings.GetMaxTermFreq());
+        document_indexes.clear();
+        term_freqs.clear();
+        for (PostingCursor cursor = index_.GetCursor(term_id); !cursor.AtEnd(); cursor.Next()) {
+            document_indexes.push_back(has_removed ? snapshot_indexes[cursor.GetDocument()] : cursor.GetDocument());
+            term_freqs.push_back(cursor.GetTermFreq());
+        }
+        writer.WriteArray(document_indexes);
+        writer.WriteArray(term_freqs);
+    }
+
+    // Позиции слов идут в порядке термов прямого индекса, который восстанавливается из списков вхождений.
+    for (const DocumentData& document_data : documents_) {
+        if (document_data.is_alive) {
+            writer.Write(static_cast<uint64_t>(document_data.positions.size()));
+            writer.WriteArray(document_data.position_offsets);
+            writer.WriteArray(document_data.positions);
+        }
+    }
+    writer.Finish();
+}
+
+SearchServer SearchServer::LoadSnapshot(const string& path) {
+    const MappedFile file(path);
+    SnapshotReader reader(file);
+
+    vector<string> stop_words(reader.Read<uint64_t>());
+    for (string& stop_word : stop_words) {
+        stop_word = reader.ReadString();
+    }
+    SearchServer server(stop_words);
+
+    const uint64_t document_count = reader.Read<uint64_t>();
+    server.documents_.reserve(document_count);
+    for (uint64_t i = 0; i < document_count; ++i) {
+        const int document_id = reader.Read<int32_t>();
+        const int rating = reader.Read<int32_t>();
+        const int32_t status_code = reader.Read<int32_t>();
+        if (status_code < 0 || status_code >= DOCUMENT_STATUS_COUNT) {
+            throw runtime_error("snapshot contains an invalid document status"s);
+        }
+        const auto status = static_cast<DocumentStatus>(status_code);
+        if (document_id < 0 || !server.document_id_to_index_.emplace(document_id, static_cast<int>(i)).second) {
+            throw runtime_error("snapshot contains an invalid document id"s);
+        }
+        server.documents_.push_back(DocumentData{document_id, rating, status});
+        server.SetStatusBit(static_cast<int>(i), status);
+        server.document_ids_.insert(document_id);
+    }
+
+    const uint64_t term_count = reader.Read<uint64_t>();
+    vector<int> document_indexes;
+    vector<double> term_freqs;
+    for (uint64_t i = 0; i < term_count; ++i) {
+        const TermId term_id = server.index_.InternTerm(reader.ReadString());
+        if (term_id != static_cast<TermId>(i)) {
+            throw runtime_error("snapshot contains a duplicate term"s);
+        }
+        const uint64_t posting_count = reader.Read<uint64_t>();
+        // Верхняя граница TF пересчитывается при построении сжатого списка.
+        reader.Read<double>();
+        reader.ReadArray(document_indexes, posting_count);
+        reader.ReadArray(term_freqs, posting_count);
+        for (size_t pos = 0; pos < document_indexes.size(); ++pos) {
+            const int document_index = document_indexes[pos];
+            if (document_index < 0 || static_cast<uint64_t>(document_index) >= document_count
+                || (pos > 0 && document_indexes[pos - 1] >= document_index)) {
+                throw runtime_error("snapshot contains an invalid posting list"s);
             }
+            DocumentData& document_data = server.documents_[document_index];
+            document_data.term_ids.push_back(term_id);
+            document_data.term_freqs.push_back(term_freqs[pos]);
         }
-        return {matched_words, documents_.at(document_id).status};
+        server.index_.AppendPostings(term_id, document_indexes, term_freqs);
     }
 
+    for (DocumentData& document_data : server.documents_) {
+        const uint64_t position_count = reader.Read<uint64_t>();
+        reader.ReadArray(document_data.position_offsets, document_data.term_ids.size() + 1);
+        reader.ReadArray(document_data.positions, position_count);
+        const auto& offsets = document_data.position_offsets;
+        if (offsets.front() != 0 || static_cast<uint64_t>(offsets.back()) != position_count
+            || !is_sorted(offsets.begin(), offsets.end())) {
+            throw runtime_error("snapshot contains invalid word positions"s);
+        }
+        document_data.word_count = static_cast<int>(position_count);
+        server.total_word_count_ += document_data.word_count;
+    }
+    if (!reader.AtEnd()) {
+        throw runtime_error("snapshot has trailing data"s);
+    }
+    server.index_.CompactPostings();
+    server.GrowInverseDocumentFreqCache();
+    return server;
+}
+
 int SearchServer::GetDocumentId(int index) const{
-            return documents_id_.at(index);
+            if (index < 0 || index >= GetDocumentCount()) {
+                throw out_of_range("document index is out of range"s);
+            }
+            if (documents_.size() == document_ids_.size()) {
+                return documents_[index].id;
+            }
+            // Живые документы отмечены ровно в одной из карт статусов.
+            const DocumentStatusSet all_statuses = DocumentStatusSet::All();
+            for (size_t word_index = 0;; ++word_index) {
+                const uint64_t word = GetStatusWord(all_statuses, word_index);
+                const int live_count = static_cast<int>(bitset<64>(word).count());
+                if (index >= live_count) {
+                    index -= live_count;
+                    continue;
+                }
+                for (int bit = 0;; ++bit) {
+                    if (((word >> bit) & 1) != 0 && index-- == 0) {
+                        return documents_[word_index * 64 + bit].id;
+                    }
+                }
+            }
 }
 
-bool SearchServer::IsStopWord(const string& word) const {
+bool SearchServer::IsStopWord(string_view word) const {
         return stop_words_.count(word) > 0;
     }
 
-vector<string> SearchServer::SplitIntoWordsNoStop(const string& text) const {
-        vector<string> words;
-        for (const string& word : SplitIntoWords(text)) {
+vector<string_view> SearchServer::SplitIntoWordsNoStop(string_view text) const {
+        vector<string_view> words;
+        for (const string_view word : SplitIntoWords(text)) {
             if(!IsValidWord(word)){
             throw invalid_argument("presence of invalid characters in the document being added."s);
         }
@@ -91,14 +703,120 @@ int SearchServer::ComputeAverageRating(const vector<int>& ratings) {
         if (ratings.empty()) {
             return 0;
         }
-        int rating_sum = 0;
+        int64_t rating_sum = 0;
         for (const int rating : ratings) {
             rating_sum += rating;
         }
-        return rating_sum / static_cast<int>(ratings.size());
+        return static_cast<int>(rating_sum / static_cast<int64_t>(ratings.size()));
     }
 
-SearchServer::QueryWord SearchServer::ParseQueryWord(string text) const {
+void SearchServer::FillForwardIndex(DocumentData& document_data, const PreparedDocument& document,
+                                    const vector<TermId>& word_term_ids) {
+    vector<pair<TermId, size_t>> term_slots;
+    term_slots.reserve(word_term_ids.size());
+    for (size_t i = 0; i < word_term_ids.size(); ++i) {
+        term_slots.emplace_back(word_term_ids[i], i);
+    }
+    sort(term_slots.begin(), term_slots.end());
+
+    document_data.term_ids.reserve(term_slots.size());
+    document_data.term_freqs.reserve(term_slots.size());
+    document_data.position_offsets.reserve(term_slots.size() + 1);
+    document_data.position_offsets.push_back(0);
+    document_data.positions.reserve(document.positions.size());
+    for (const auto& [term_id, slot] : term_slots) {
+        document_data.term_ids.push_back(term_id);
+        document_data.term_freqs.push_back(document.word_freqs[slot].second);
+        document_data.positions.insert(document_data.positions.end(),
+                                       document.positions.begin() + document.position_offsets[slot],
+                                       document.positions.begin() + document.position_offsets[slot + 1]);
+        document_data.position_offsets.push_back(static_cast<int>(document_data.positions.size()));
+    }
+    document_data.word_count = static_cast<int>(document.positions.size());
+}
+
+void SearchServer::RelevanceAccumulator::Reset(size_t range_size) {
+    for (const int slot : touched) {
+        relevances[slot] = 0.0;
+        marks[slot] = UNTOUCHED;
+    }
+    touched.clear();
+    if (relevances.size() < range_size) {
+        relevances.resize(range_size, 0.0);
+        marks.resize(range_size, UNTOUCHED);
+    }
+}
+
+int SearchServer::FindDocumentTerm(const DocumentData& document_data, TermId term_id) {
+    const auto it = lower_bound(document_data.term_ids.begin(), document_data.term_ids.end(), term_id);
+    if (it == document_data.term_ids.end() || *it != term_id) {
+        return -1;
+    }
+    return static_cast<int>(it - document_data.term_ids.begin());
+}
+
+bool SearchServer::ContainsPhrase(const DocumentData& document_data, const vector<TermId>& phrase) {
+    vector<pair<vector<int>::const_iterator, vector<int>::const_iterator>> word_positions;
+    for (const TermId term_id : phrase) {
+        const int slot = FindDocumentTerm(document_data, term_id);
+        if (slot < 0) {
+            return false;
+        }
+        word_positions.emplace_back(document_data.positions.begin() + document_data.position_offsets[slot],
+                                    document_data.positions.begin() + document_data.position_offsets[slot + 1]);
+    }
+    for (auto it = word_positions.front().first; it != word_positions.front().second; ++it) {
+        bool is_match = true;
+        for (size_t i = 1; i < word_positions.size() && is_match; ++i) {
+            is_match = binary_search(word_positions[i].first, word_positions[i].second, *it + static_cast<int>(i));
+        }
+        if (is_match) {
+            return true;
+        }
+    }
+    return false;
+}
+
+SearchServer::DeadlineGuard::DeadlineGuard(const optional<chrono::steady_clock::time_point>& deadline)
+        : deadline_(deadline) {
+    if (deadline_) {
+        Check();
+    }
+}
+
+void SearchServer::DeadlineGuard::Check() {
+    if (chrono::steady_clock::now() >= *deadline_) {
+        throw DeadlineExceeded();
+    }
+    steps_left_ = CHECK_INTERVAL;
+}
+
+SearchServer::MinusWordsFilter::MinusWordsFilter(const InvertedIndex& index, const vector<TermId>& minus_terms) {
+    for (const TermId term_id : minus_terms) {
+        cursors_.push_back(index.GetCursor(term_id));
+    }
+}
+
+bool SearchServer::MinusWordsFilter::IsExcluded(int document_index) {
+    for (PostingCursor& cursor : cursors_) {
+        cursor.SkipTo(document_index);
+        if (!cursor.AtEnd() && cursor.GetDocument() == document_index) {
+            return true;
+        }
+    }
+    return false;
+}
+
+string_view SearchServer::FindDocumentWord(const DocumentData& document_data, string_view word) const {
+        const TermId term_id = index_.FindTerm(word);
+        if (term_id == InvertedIndex::NO_TERM
+            || !binary_search(document_data.term_ids.begin(), document_data.term_ids.end(), term_id)) {
+            return {};
+        }
+        return index_.GetTerm(term_id);
+    }
+
+SearchServer::QueryWord SearchServer::ParseQueryWord(string_view text) const {
         bool is_minus = false;
         if(!IsValidWord(text)){
             throw invalid_argument("There are invalid characters in the words of the search query"s);
@@ -108,7 +826,7 @@ SearchServer::QueryWord SearchServer::ParseQueryWord(string text) const {
                 throw invalid_argument("The absence of text after the minus symbol in the search query"s);
             }
             is_minus = true;
-            text = text.substr(1);
+            text.remove_prefix(1);
         }
         if(!text.empty()){
             if(text[0] == '-') {
@@ -118,28 +836,155 @@ SearchServer::QueryWord SearchServer::ParseQueryWord(string text) const {
         return {text, is_minus, IsStopWord(text)};
     }
 
-SearchServer::Query SearchServer::ParseQuery(const string& text) const {
+SearchServer::Query SearchServer::ParseQuery(string_view text, bool deduplicate) const {
         Query query;
-        for (const string& word : SplitIntoWords(text)) {
-            const QueryWord query_word = ParseQueryWord(word);
-            if(!query_word.is_stop) {
-                if (query_word.is_minus) {
-                    query.minus_words.insert(query_word.data);
-                } else {
-                    query.plus_words.insert(query_word.data);
+        ParseQuery(text, query, deduplicate);
+        return query;
+    }
+
+// Фраза начинается со слова, открытого кавычкой, и заканчивается словом с кавычкой в конце.
+// Кавычка в любом другом месте слова считается ошибкой, а не его частью.
+void SearchServer::ParseQuery(string_view text, Query& query, bool deduplicate) const {
+        StageTimer timer(SearchStage::PARSE);
+        query.plus_words.clear();
+        query.minus_words.clear();
+        query.phrases.clear();
+        bool in_phrase = false;
+        ForEachWord(text, [this, &query, &in_phrase](string_view word) {
+            bool closes_phrase = false;
+            if (!in_phrase && word[0] == '"') {
+                word.remove_prefix(1);
+                in_phrase = true;
+                query.phrases.emplace_back();
+            }
+            if (in_phrase && !word.empty() && word.back() == '"') {
+                word.remove_suffix(1);
+                closes_phrase = true;
+            }
+            if (word.find('"') != string_view::npos) {
+                throw invalid_argument("Stray quotation mark in the search query"s);
+            }
+            if (!word.empty()) {
+                const QueryWord query_word = ParseQueryWord(word);
+                if (in_phrase && query_word.is_minus) {
+                    throw invalid_argument("Minus words are not allowed inside a phrase in the search query"s);
                 }
+                if (!query_word.is_stop) {
+                    if (query_word.is_minus) {
+                        query.minus_words.push_back(query_word.data);
+                    } else {
+                        query.plus_words.push_back(query_word.data);
+                    }
+                    if (in_phrase) {
+                        query.phrases.back().push_back(query_word.data);
+                    }
+                }
+            }
+            if (closes_phrase) {
+                in_phrase = false;
+            }
+        });
+        if (in_phrase) {
+            throw invalid_argument("Unclosed quotation mark in the search query"s);
+        }
+        query.phrases.erase(remove_if(query.phrases.begin(), query.phrases.end(), [](const auto& phrase) {
+            return phrase.empty();
+        }), query.phrases.end());
+        if (deduplicate) {
+            for (auto* words : {&query.plus_words, &query.minus_words}) {
+                sort(words->begin(), words->end());
+                words->erase(unique(words->begin(), words->end()), words->end());
             }
         }
-        return query;
     }
 
-double SearchServer::ComputeWordInverseDocumentFreq(const string& word) const {
-        return log(GetDocumentCount() * 1.0 / word_to_document_freqs_.at(word).size());
+void SearchServer::ResolveQuery(const Query& query, const CorpusStatistics* statistics, RankingModel ranking,
+                                QueryTerms& terms) const {
+        StageTimer timer(SearchStage::RESOLVE);
+        terms.plus_terms.clear();
+        terms.plus_inverse_document_freqs.clear();
+        terms.minus_terms.clear();
+        terms.phrases.clear();
+        terms.all_plus_words_found = true;
+        terms.ranking = ranking;
+        terms.average_word_count = 0.0;
+        if (ranking == RankingModel::BM25) {
+            const int document_count = statistics == nullptr ? GetDocumentCount() : statistics->document_count;
+            const int64_t word_count = statistics == nullptr ? total_word_count_ : statistics->word_count;
+            terms.average_word_count = document_count == 0 ? 0.0 : word_count * 1.0 / document_count;
+        }
+        for (const string_view word : query.plus_words) {
+            const TermId term_id = index_.FindTerm(word);
+            if (term_id == InvertedIndex::NO_TERM || index_.GetPostings(term_id).empty()) {
+                terms.all_plus_words_found = false;
+                continue;
+            }
+            terms.plus_terms.push_back(term_id);
+            if (statistics == nullptr) {
+                terms.plus_inverse_document_freqs.push_back(ComputeWordInverseDocumentFreq(term_id, ranking));
+                continue;
+            }
+            const auto freq_it = statistics->document_freqs.find(word);
+            if (freq_it == statistics->document_freqs.end() || freq_it->second == 0) {
+                terms.plus_terms.pop_back();
+                terms.all_plus_words_found = false;
+                continue;
+            }
+            terms.plus_inverse_document_freqs.push_back(ranking == RankingModel::BM25
+                ? ComputeBm25InverseDocumentFreq(statistics->document_count, freq_it->second)
+                : ComputeInverseDocumentFreq(statistics->document_count, freq_it->second));
+        }
+        for (const string_view word : query.minus_words) {
+            const TermId term_id = index_.FindTerm(word);
+            if (term_id != InvertedIndex::NO_TERM) {
+                terms.minus_terms.push_back(term_id);
+            }
+        }
+        for (const auto& phrase : query.phrases) {
+            terms.phrases.push_back(ResolvePhrase(phrase));
+        }
+    }
+
+vector<TermId> SearchServer::ResolvePhrase(const vector<string_view>& phrase) const {
+        vector<TermId> term_ids;
+        term_ids.reserve(phrase.size());
+        for (const string_view word : phrase) {
+            const TermId term_id = index_.FindTerm(word);
+            term_ids.push_back(term_id == InvertedIndex::NO_TERM || index_.GetPostings(term_id).empty() ? InvertedIndex::NO_TERM : term_id);
+        }
+        return term_ids;
+    }
+
+double SearchServer::ComputeInverseDocumentFreq(int document_count, int document_freq) {
+        return log(document_count * 1.0 / document_freq);
     }
 
+double SearchServer::ComputeBm25InverseDocumentFreq(int document_count, int document_freq) {
+        return log((document_count - document_freq + 0.5) / (document_freq + 0.5) + 1.0);
+    }
+
+double SearchServer::ComputeWordInverseDocumentFreq(TermId term_id, RankingModel ranking) const {
+        const int document_count = GetDocumentCount();
+        const int document_freq = static_cast<int>(index_.GetPostings(term_id).size());
+        // Нулевой ключ не совпадает ни с одним настоящим: в непустом списке document_freq > 0.
+        const uint64_t key = static_cast<uint64_t>(document_count) << 32 | static_cast<uint32_t>(document_freq);
+        CachedInverseDocumentFreq& cached = inverse_document_freqs_[term_id];
+        if (cached.key.load(memory_order_acquire) != key) {
+            cached.tf_idf.store(ComputeInverseDocumentFreq(document_count, document_freq), memory_order_relaxed);
+            cached.bm25.store(ComputeBm25InverseDocumentFreq(document_count, document_freq), memory_order_relaxed);
+            cached.key.store(key, memory_order_release);
+        }
+        return ranking == RankingModel::BM25 ? cached.bm25.load(memory_order_relaxed) : cached.tf_idf.load(memory_order_relaxed);
+    }
+
+void SearchServer::GrowInverseDocumentFreqCache() {
+    while (inverse_document_freqs_.size() < index_.GetTermCount()) {
+        inverse_document_freqs_.emplace_back();
+    }
+}
 
 
-bool SearchServer::IsValidWord(const string& word) {
+bool SearchServer::IsValidWord(string_view word) {
         return none_of(word.begin(), word.end(), [](char c) {
             return c >= '\0' && c < ' ';
         });
@@ -2,76 +2,482 @@
 
 
 #include "document.h"
+#include "inverted_index.h"
+#include "search_instrumentation.h"
 #include "string_processing.h"
+#include "thread_scratch.h"
+#include "top_documents.h"
 
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <execution>
+#include <iterator>
 #include <limits>
 #include <map>
+#include <optional>
 #include <set> 
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <type_traits>
+#include <unordered_map>
 #include <vector>
 
 
 const int MAX_RESULT_DOCUMENT_COUNT = 5;
 
+enum class TopKMode {
+    EXHAUSTIVE,
+    // Обход в стиле WAND: документ не оценивается, если сумма верхних границ вклада его слов
+    // меньше релевантности текущего K-го результата. Выдача совпадает с EXHAUSTIVE.
+    WAND,
+};
+
+enum class QueryMatch {
+    // Документ подходит, если содержит хотя бы одно плюс-слово.
+    ANY,
+    // Документ должен содержать все плюс-слова; оцениваются только документы из пересечения списков.
+    ALL,
+};
+
+enum class RankingModel {
+    TF_IDF,
+    // Okapi BM25 по длинам документов, сохранённым при индексации.
+    BM25,
+};
+
+const double BM25_K1 = 1.2;
+const double BM25_B = 0.75;
+
+struct TopKOptions {
+    size_t count = MAX_RESULT_DOCUMENT_COUNT;
+    TopKMode mode = TopKMode::EXHAUSTIVE;
+    QueryMatch match = QueryMatch::ANY;
+    RankingModel ranking = RankingModel::TF_IDF;
+    // Выдача продолжается с документа, следующего за after в порядке CompareDocuments:
+    // так страницы листаются без повторной выборки всех предыдущих.
+    std::optional<Document> after;
+    // Когда срок истекает, обход списков вхождений прерывается исключением DeadlineExceeded.
+    std::optional<std::chrono::steady_clock::time_point> deadline;
+};
+
+class DeadlineExceeded : public std::runtime_error {
+public:
+    DeadlineExceeded()
+        : std::runtime_error("query deadline exceeded") {
+    }
+};
+
+// Страница выдачи FindTopDocumentsPage. Следующая страница запрашивается
+// с TopKOptions::after, равным последнему документу этой.
+struct ResultPage {
+    std::vector<Document> documents;
+    bool has_more = false;
+};
+
+template <typename ExecutionPolicy>
+using EnableIfExecutionPolicy = std::enable_if_t<std::is_execution_policy_v<std::decay_t<ExecutionPolicy>>, bool>;
+
+// Документ, прошедший проверку и разбиение на слова, но ещё не добавленный в индекс.
+// Слова ссылаются на исходный текст, который должен жить до вызова AddPreparedDocument.
+// Номера вхождений слова word_freqs[i] среди слов документа без стоп-слов лежат в positions
+// с position_offsets[i] по position_offsets[i + 1].
+struct PreparedDocument {
+    int id = 0;
+    int rating = 0;
+    DocumentStatus status = DocumentStatus::ACTUAL;
+    std::vector<std::pair<std::string_view, double>> word_freqs;
+    std::vector<int> position_offsets;
+    std::vector<int> positions;
+};
+
+// Число документов и документные частоты слов запроса по всему корпусу, когда он разбит
+// на несколько серверов. С ней IDF на каждом сервере совпадает с IDF общего индекса.
+struct CorpusStatistics {
+    int document_count = 0;
+    // Суммарное число слов документов без стоп-слов, для средней длины в BM25.
+    int64_t word_count = 0;
+    std::map<std::string, int, std::less<>> document_freqs;
+
+    void Merge(const CorpusStatistics& other);
+};
+
+// Описание документа для пакетной загрузки; текст должен жить до конца вызова AddDocuments.
+struct RawDocument {
+    int id = 0;
+    std::string_view text;
+    DocumentStatus status = DocumentStatus::ACTUAL;
+    std::vector<int> ratings;
+};
+
 class SearchServer {
 public:
     template <typename StringContainer>
     explicit SearchServer(const StringContainer& stop_words);
     explicit SearchServer(const std::string& stop_words_text);
+    explicit SearchServer(std::string_view stop_words_text);
     
-    void AddDocument(int document_id, const std::string& document, DocumentStatus status, const std::vector<int>& ratings);
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+
+    // Первая половина AddDocument: проверка id и слов, разбиение текста и подсчёт TF.
+    // Не меняет индекс и может выполняться параллельно с чтением и другими подготовками.
+    PreparedDocument PrepareDocument(int document_id, std::string_view document, DocumentStatus status,
+                                     const std::vector<int>& ratings) const;
+    // Вторая половина AddDocument: проверка уникальности id и запись в индекс.
+    void AddPreparedDocument(const PreparedDocument& document);
+
+    // Пакетное добавление: id проверяются до изменения индекса, тексты разбираются параллельно
+    // в частичные индексы по диапазонам пакета, которые затем сливаются в основной за один проход.
+    // При любой ошибке индекс остаётся прежним.
+    void AddDocuments(const std::vector<RawDocument>& documents);
+
+    // Переносит документ из другого сервера с теми же TF, рейтингом и статусом, без повторного
+    // разбора текста. Используется при слиянии сегментов.
+    void AddDocumentCopy(const SearchServer& source, int document_id);
 
+    // Убирает из таблицы документов строки удалённых документов и упаковывает ещё не сжатые
+    // хвосты списков вхождений. Обходит весь индекс, поэтому пакетное добавление его не вызывает;
+    // имеет смысл, когда индекс долго не будет пополняться. После загрузки снимка вызывается сам.
+    void CompactIndex();
+
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate) const;
+    std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, const DocumentStatus& status) const; 
     template <typename DocumentPredicate>
-    std::vector<Document> FindTopDocuments(const std::string& raw_query, DocumentPredicate document_predicate) const;
-    std::vector<Document> FindTopDocuments(const std::string& raw_query) const;
-    std::vector<Document> FindTopDocuments(const std::string& raw_query, const DocumentStatus& status) const; 
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate, const TopKOptions& options) const;
+
+    template <typename ExecutionPolicy, typename DocumentPredicate, EnableIfExecutionPolicy<ExecutionPolicy> = true>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query, DocumentPredicate document_predicate) const;
+    template <typename ExecutionPolicy, EnableIfExecutionPolicy<ExecutionPolicy> = true>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query) const;
+    template <typename ExecutionPolicy, EnableIfExecutionPolicy<ExecutionPolicy> = true>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query, const DocumentStatus& status) const;
+    template <typename ExecutionPolicy, typename DocumentPredicate, EnableIfExecutionPolicy<ExecutionPolicy> = true>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query, DocumentPredicate document_predicate,
+                                           const TopKOptions& options) const;
+    // IDF считается по переданной статистике, а не по собственному индексу. Слово, которого
+    // нет в статистике, считается отсутствующим во всём корпусе.
+    template <typename ExecutionPolicy, typename DocumentPredicate, EnableIfExecutionPolicy<ExecutionPolicy> = true>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query, DocumentPredicate document_predicate,
+                                           const TopKOptions& options, const CorpusStatistics& statistics) const;
+
+    // Параллельный поиск, в котором шарды диапазона документов выполняет run_shards(shard_count, job):
+    // он должен вызвать job(i) для каждого i из [0, shard_count) и вернуться после их завершения.
+    // job не бросает исключений, ошибка шарда пробрасывается после завершения всех.
+    template <typename ShardRunner, typename DocumentPredicate>
+    std::vector<Document> FindTopDocumentsSharded(ShardRunner run_shards, std::string_view raw_query,
+                                                  DocumentPredicate document_predicate, const TopKOptions& options) const;
+
+    // Страница из options.count документов после options.after. Каждая страница обходит списки
+    // вхождений заново, но держит в куче только options.count + 1 документов.
+    template <typename DocumentPredicate>
+    ResultPage FindTopDocumentsPage(std::string_view raw_query, DocumentPredicate document_predicate, const TopKOptions& options) const;
+
+    // Число документов сервера и документные частоты встречающихся в нём плюс-слов запроса.
+    CorpusStatistics GetCorpusStatistics(std::string_view raw_query) const;
     
     int GetDocumentCount() const;
+    // Число документов с одним из статусов набора; считается по счётчикам за O(1).
+    int GetDocumentCount(DocumentStatusSet statuses) const;
+
+    // Увеличивается при каждом изменении индекса; кэши выдачи сверяют по нему актуальность.
+    uint64_t GetGeneration() const;
+
+    // Объём сжатых списков вхождений в байтах.
+    size_t GetIndexMemoryUsage() const;
+
+    // Число слов документа без стоп-слов или 0, если документа нет.
+    int GetDocumentWordCount(int document_id) const;
+
+    // Слова запроса отсортированы и не повторяются; представления ссылаются на текст запроса.
+    // Слова фраз в кавычках сохраняют порядок и входят также в plus_words.
+    struct Query {
+        std::vector<std::string_view> plus_words;
+        std::vector<std::string_view> minus_words;
+        std::vector<std::vector<std::string_view>> phrases;
+    };
 
-    std::tuple<std::vector<std::string>, DocumentStatus> MatchDocument(const std::string& raw_query, int document_id) const;
+    // Без deduplicate слова остаются в порядке запроса и могут повторяться.
+    // Разобранный один раз запрос можно передать в перегрузки ниже вместо текста.
+    Query ParseQuery(std::string_view text, bool deduplicate = true) const;
+
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(const Query& query, DocumentPredicate document_predicate,
+                                           const TopKOptions& options = {}) const;
+
+    // Суммарная длина списков вхождений плюс- и минус-слов запроса, то есть объём работы полного перебора.
+    uint64_t GetQueryPostingCount(std::string_view raw_query) const;
+    uint64_t GetQueryPostingCount(const Query& query) const;
+
+    // Каноническая запись разобранного запроса: отсортированные плюс-слова, затем минус-слова,
+    // без стоп-слов и повторов. Одинаковые по смыслу запросы дают одну и ту же строку.
+    std::string NormalizeQuery(std::string_view raw_query) const;
+    std::string NormalizeQuery(const Query& query) const;
+
+    std::set<int>::const_iterator begin() const;
+    std::set<int>::const_iterator end() const;
+
+    // Частоты слов документа из прямого индекса; для неизвестного id возвращается пустой словарь.
+    std::map<std::string_view, double> GetWordFrequencies(int document_id) const;
+    // Отсортированные id термов документа; для неизвестного id возвращается пустой вектор.
+    const std::vector<TermId>& GetDocumentTermIds(int document_id) const;
+
+    void RemoveDocument(int document_id);
+    void RemoveDocument(const std::execution::sequenced_policy&, int document_id);
+    void RemoveDocument(const std::execution::parallel_policy&, int document_id);
+
+    // Снимок хранит стоп-слова, документы и словарь термов со списками вхождений;
+    // удалённые документы в него не попадают. Ошибки ввода-вывода и повреждённый
+    // снимок приводят к исключению std::runtime_error. Файл path заменяется целиком только
+    // после успешной записи, поэтому при ошибке прежний снимок остаётся на месте.
+    void SaveSnapshot(const std::string& path) const;
+    static SearchServer LoadSnapshot(const std::string& path);
+
+    // Совпавшие слова ссылаются на хранилище термов индекса, а не на raw_query.
+    // Минус-слова проверяются первыми: при совпадении любого из них плюс-слова не просматриваются.
+    std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(std::string_view raw_query, int document_id) const;
+    std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(const std::execution::sequenced_policy&,
+                                                                            std::string_view raw_query, int document_id) const;
+    std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(const std::execution::parallel_policy&,
+                                                                            std::string_view raw_query, int document_id) const;
     
+    // Id документа с порядковым номером index в порядке добавления. O(1), если после удалений
+    // был вызван CompactIndex, иначе проход по битовым картам статусов за O(N / 64).
     int GetDocumentId(int index) const;
 
 private:
+    // Удалённый документ остаётся в таблице до CompactIndex, чтобы не сдвигать индексы в списках
+    // вхождений, но теряет прямой индекс и флаг is_alive. Позиции слова term_ids[i] для поиска фраз лежат
+    // в positions с position_offsets[i] по position_offsets[i + 1].
     struct DocumentData {
-        int rating;
-        DocumentStatus status;
+        DocumentData() = default;
+        DocumentData(int id, int rating, DocumentStatus status)
+            : id(id)
+            , rating(rating)
+            , status(status) {
+        }
+
+        int id = 0;
+        int rating = 0;
+        DocumentStatus status = DocumentStatus::ACTUAL;
+        bool is_alive = true;
+        std::vector<TermId> term_ids;
+        std::vector<double> term_freqs;
+        std::vector<int> position_offsets;
+        std::vector<int> positions;
+        int word_count = 0;
     };
-    const std::set<std::string> stop_words_;
-    std::map<std::string, std::map<int, double>> word_to_document_freqs_;
-    std::map<int, DocumentData> documents_;
-    std::vector<int> documents_id_;
+    // Плотный накопитель релевантности по диапазону индексов документов: ячейка i относится
+    // к документу first_index + i, поэтому накопитель потока параллельного поиска занимает
+    // память по ширине шарда, а не по всему индексу. Reset обнуляет только ячейки из touched,
+    // поэтому стоимость запроса не зависит от размера индекса.
+    struct RelevanceAccumulator {
+        static constexpr uint8_t UNTOUCHED = 0;
+        static constexpr uint8_t CANDIDATE = 1;
+        static constexpr uint8_t EXCLUDED = 2;
+        // Если затронута хотя бы 1/SCAN_RATIO диапазона, кандидаты выбираются проходом
+        // по диапазону, а не сортировкой touched.
+        static constexpr size_t SCAN_RATIO = 16;
 
-    bool IsStopWord(const std::string& word) const;
+        std::vector<double> relevances;
+        std::vector<uint8_t> marks;
+        // Номера затронутых ячеек, а не индексы документов.
+        std::vector<int> touched;
 
-    std::vector<std::string> SplitIntoWordsNoStop(const std::string& text) const;
+        void Reset(size_t range_size);
+    };
+    // IDF терма для обеих моделей ранжирования. Значения действительны, пока key совпадает
+    // с текущими числом документов и длиной списка вхождений. Кэш заполняется из константных
+    // запросов, в том числе параллельных, поэтому поля атомарные: значения пишутся до ключа.
+    struct CachedInverseDocumentFreq {
+        std::atomic<uint64_t> key{0};
+        std::atomic<double> tf_idf{0.0};
+        std::atomic<double> bm25{0.0};
+    };
+    const std::set<std::string, std::less<>> stop_words_;
+    InvertedIndex index_;
+    // Плотная таблица документов в порядке добавления; позиция в ней служит
+    // индексом документа в списках вхождений.
+    std::vector<DocumentData> documents_;
+    std::unordered_map<int, int> document_id_to_index_;
+    std::set<int> document_ids_;
+    uint64_t generation_ = 0;
+    int64_t total_word_count_ = 0;
+    mutable std::deque<CachedInverseDocumentFreq> inverse_document_freqs_;
+    // Бит i карты статуса s установлен, если документ с индексом i жив и имеет статус s.
+    // По ним фильтр DocumentStatusSet проверяется и пропускает документы пачками по 64,
+    // не читая DocumentData.
+    std::array<std::vector<uint64_t>, DOCUMENT_STATUS_COUNT> status_bitmaps_;
+    std::array<int, DOCUMENT_STATUS_COUNT> status_counts_{};
+
+    void SetStatusBit(int document_index, DocumentStatus status);
+    void ClearStatusBit(int document_index, DocumentStatus status);
+    // Слово битовых карт с документами word_index * 64 ... word_index * 64 + 63 из набора statuses.
+    uint64_t GetStatusWord(DocumentStatusSet statuses, size_t word_index) const;
+    // Первый документ из [document_index, last_index) со статусом из набора или last_index.
+    int FindNextDocument(DocumentStatusSet statuses, int document_index, int last_index) const;
+
+    // Проходит ли документ предикат. Для DocumentStatusSet хватает битовых карт.
+    template <typename DocumentPredicate>
+    bool AcceptsDocument(const DocumentPredicate& document_predicate, int document_index) const;
+    // Куда можно перейти от отвергнутого документа document_index: для DocumentStatusSet
+    // сразу к следующему документу из набора, для прочих предикатов к соседнему.
+    template <typename DocumentPredicate>
+    int SkipRejectedDocuments(const DocumentPredicate& document_predicate, int document_index, int last_index) const;
+    // Ложь, только если предикат заведомо не пропустит ни одного документа.
+    template <typename DocumentPredicate>
+    bool MayAcceptDocuments(const DocumentPredicate& document_predicate) const;
+
+    bool IsStopWord(std::string_view word) const;
+
+    std::vector<std::string_view> SplitIntoWordsNoStop(std::string_view text) const;
 
     static int ComputeAverageRating(const std::vector<int>& ratings);
 
+    // Убирает строки удалённых документов и перенумеровывает живые без изменения порядка.
+    void RemoveDeletedDocuments();
+
+    // Прямой индекс документа по разобранному тексту; word_term_ids[i] - терм слова document.word_freqs[i].
+    static void FillForwardIndex(DocumentData& document_data, const PreparedDocument& document,
+                                 const std::vector<TermId>& word_term_ids);
+
+    // Слово документа из его прямого индекса или пустое представление, если слова в документе нет.
+    std::string_view FindDocumentWord(const DocumentData& document_data, std::string_view word) const;
+    // Номер терма в прямом индексе документа или -1.
+    static int FindDocumentTerm(const DocumentData& document_data, TermId term_id);
+    // Есть ли в документе слова фразы подряд (стоп-слова не считаются).
+    static bool ContainsPhrase(const DocumentData& document_data, const std::vector<TermId>& phrase);
+
+    template <typename ExecutionPolicy>
+    void RemoveDocumentImpl(ExecutionPolicy&& policy, int document_id);
+
     struct QueryWord {
-        std::string data;
+        std::string_view data;
         bool is_minus;
         bool is_stop;
     };
 
-    QueryWord ParseQueryWord(std::string text) const;
+    QueryWord ParseQueryWord(std::string_view text) const;
 
-    struct Query {
-        std::set<std::string> plus_words;
-        std::set<std::string> minus_words;
+    // Заполняет query заново, сохраняя ёмкость его векторов.
+    void ParseQuery(std::string_view text, Query& query, bool deduplicate = true) const;
+
+    struct QueryTerms {
+        std::vector<TermId> plus_terms;
+        std::vector<double> plus_inverse_document_freqs;
+        std::vector<TermId> minus_terms;
+        // Слово фразы, которого нет в индексе, получает InvertedIndex::NO_TERM.
+        std::vector<std::vector<TermId>> phrases;
+        bool all_plus_words_found = true;
+        RankingModel ranking = RankingModel::TF_IDF;
+        double average_word_count = 0.0;
+
+        // Вклад слова запроса term_index в релевантность документа.
+        double Score(size_t term_index, double term_freq, int word_count) const {
+            if (ranking == RankingModel::TF_IDF) {
+                return term_freq * plus_inverse_document_freqs[term_index];
+            }
+            const double occurrences = term_freq * word_count;
+            return plus_inverse_document_freqs[term_index] * occurrences * (BM25_K1 + 1.0)
+                   / (occurrences + BM25_K1 * (1.0 - BM25_B + BM25_B * word_count / average_word_count));
+        }
+
+        // Верхняя граница Score по списку вхождений слова для WAND.
+        double MaxScore(size_t term_index, double max_term_freq) const {
+            if (ranking == RankingModel::TF_IDF) {
+                return max_term_freq * plus_inverse_document_freqs[term_index];
+            }
+            return plus_inverse_document_freqs[term_index] * (BM25_K1 + 1.0);
+        }
     };
 
-    Query ParseQuery(const std::string& text) const;
+    // Проверяет TopKOptions::deadline при создании и затем раз в CHECK_INTERVAL шагов обхода,
+    // чтобы не читать часы на каждом вхождении.
+    class DeadlineGuard {
+    public:
+        explicit DeadlineGuard(const std::optional<std::chrono::steady_clock::time_point>& deadline);
+
+        void Step() {
+            if (deadline_ && --steps_left_ == 0) {
+                Check();
+            }
+        }
+
+    private:
+        static constexpr int CHECK_INTERVAL = 1024;
+
+        void Check();
+
+        std::optional<std::chrono::steady_clock::time_point> deadline_;
+        int steps_left_ = CHECK_INTERVAL;
+    };
 
-    double ComputeWordInverseDocumentFreq(const std::string& word) const;
+    // Пропускает документы, содержащие минус-слова; индексы документов должны возрастать.
+    class MinusWordsFilter {
+    public:
+        MinusWordsFilter(const InvertedIndex& index, const std::vector<TermId>& minus_terms);
+        bool IsExcluded(int document_index);
 
+    private:
+        std::deque<PostingCursor> cursors_;
+    };
+
+    void ResolveQuery(const Query& query, const CorpusStatistics* statistics, RankingModel ranking, QueryTerms& terms) const;
+    std::vector<TermId> ResolvePhrase(const std::vector<std::string_view>& phrase) const;
+
+    static double ComputeInverseDocumentFreq(int document_count, int document_freq);
+    static double ComputeBm25InverseDocumentFreq(int document_count, int document_freq);
+    double ComputeWordInverseDocumentFreq(TermId term_id, RankingModel ranking) const;
+    // Дополняет кэш IDF записями для новых термов; вызывается после их добавления в индекс.
+    void GrowInverseDocumentFreqCache();
+
+    template <typename DocumentPredicate>
+    void CollectRelevance(const QueryTerms& terms, int first_index, int last_index, DocumentPredicate document_predicate,
+                          RelevanceAccumulator& accumulator, TopDocumentsCollector& top_documents, QueryCounters& counters,
+                          DeadlineGuard& deadline) const;
+
+    template <typename DocumentPredicate>
+    void CollectTopByWand(const QueryTerms& terms, int first_index, int last_index, DocumentPredicate document_predicate,
+                          TopDocumentsCollector& top_documents, QueryCounters& counters, DeadlineGuard& deadline) const;
+
+    // Оценивает только документы, содержащие все обязательные слова: все плюс-слова при
+    // QueryMatch::ALL и слова фраз. Списки пересекаются начиная с самого короткого.
+    template <typename DocumentPredicate>
+    void CollectTopByIntersection(const QueryTerms& terms, QueryMatch match, int first_index, int last_index,
+                                  DocumentPredicate document_predicate, TopDocumentsCollector& top_documents,
+                                  QueryCounters& counters, DeadlineGuard& deadline) const;
+
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopInRange(const QueryTerms& terms, int first_index, int last_index,
+                                         DocumentPredicate document_predicate, const TopKOptions& options) const;
+
+    template <typename DocumentPredicate>
+    std::vector<Document> FindAllDocuments(const std::execution::sequenced_policy&, const Query& query,
+                                      DocumentPredicate document_predicate, const TopKOptions& options,
+                                      const CorpusStatistics* statistics) const;
     template <typename DocumentPredicate>
-    std::vector<Document> FindAllDocuments(const Query& query,
-                                      DocumentPredicate document_predicate) const;
+    std::vector<Document> FindAllDocuments(const std::execution::parallel_policy&, const Query& query,
+                                      DocumentPredicate document_predicate, const TopKOptions& options,
+                                      const CorpusStatistics* statistics) const;
+    // Документы делятся на шарды по диапазонам индексов, каждый шард накапливает релевантность
+    // в собственной карте без блокировок. Слова запроса внутри шарда обходятся в том же
+    // порядке, что и в последовательной версии, поэтому суммы совпадают бит в бит.
+    template <typename ShardRunner, typename DocumentPredicate>
+    std::vector<Document> FindAllDocumentsSharded(ShardRunner run_shards, const Query& query,
+                                                  DocumentPredicate document_predicate, const TopKOptions& options,
+                                                  const CorpusStatistics* statistics) const;
     
-    static bool IsValidWord(const std::string& word);
+    static bool IsValidWord(std::string_view word);
 };
 
 template <typename StringContainer>
@@ -83,56 +489,469 @@ template <typename StringContainer>
     }
     
 template <typename DocumentPredicate>
-    std::vector<Document> SearchServer::FindTopDocuments(const std::string& raw_query, DocumentPredicate document_predicate) const {
-        using namespace std;
-    const Query query = ParseQuery(raw_query);
-    auto matched_documents = FindAllDocuments(query, document_predicate);
+    std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate) const {
+    return FindTopDocuments(std::execution::seq, raw_query, document_predicate);
+}
+
+template <typename DocumentPredicate>
+    std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate, const TopKOptions& options) const {
+    return FindTopDocuments(std::execution::seq, raw_query, document_predicate, options);
+}
+
+template <typename ExecutionPolicy, typename DocumentPredicate, EnableIfExecutionPolicy<ExecutionPolicy>>
+    std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query, DocumentPredicate document_predicate) const {
+    return FindTopDocuments(policy, raw_query, document_predicate, TopKOptions{});
+}
+
+template <typename ExecutionPolicy, typename DocumentPredicate, EnableIfExecutionPolicy<ExecutionPolicy>>
+    std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query, DocumentPredicate document_predicate,
+                                                         const TopKOptions& options) const {
+    ThreadScratch<Query> query;
+    ParseQuery(raw_query, *query);
+    return FindAllDocuments(policy, *query, document_predicate, options, nullptr);
+}
 
-    sort(matched_documents.begin(), matched_documents.end(),
-             [](const Document& lhs, const Document& rhs) {
-        if (std::abs(lhs.relevance - rhs.relevance) < numeric_limits<double>::epsilon()) {
-            return lhs.rating > rhs.rating;
+template <typename ExecutionPolicy, typename DocumentPredicate, EnableIfExecutionPolicy<ExecutionPolicy>>
+    std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query, DocumentPredicate document_predicate,
+                                                         const TopKOptions& options, const CorpusStatistics& statistics) const {
+    ThreadScratch<Query> query;
+    ParseQuery(raw_query, *query);
+    return FindAllDocuments(policy, *query, document_predicate, options, &statistics);
+}
+
+template <typename DocumentPredicate>
+    std::vector<Document> SearchServer::FindTopDocuments(const Query& query, DocumentPredicate document_predicate,
+                                                         const TopKOptions& options) const {
+    return FindAllDocuments(std::execution::seq, query, document_predicate, options, nullptr);
+}
+
+template <typename ShardRunner, typename DocumentPredicate>
+    std::vector<Document> SearchServer::FindTopDocumentsSharded(ShardRunner run_shards, std::string_view raw_query,
+                                                                DocumentPredicate document_predicate, const TopKOptions& options) const {
+    ThreadScratch<Query> query;
+    ParseQuery(raw_query, *query);
+    return FindAllDocumentsSharded(run_shards, *query, document_predicate, options, nullptr);
+}
+
+template <typename DocumentPredicate>
+ResultPage SearchServer::FindTopDocumentsPage(std::string_view raw_query, DocumentPredicate document_predicate,
+                                              const TopKOptions& options) const {
+    // Лишний документ показывает, есть ли следующая страница.
+    TopKOptions page_options = options;
+    page_options.count = options.count + 1;
+    ResultPage page;
+    page.documents = FindTopDocuments(std::execution::seq, raw_query, document_predicate, page_options);
+    if (page.documents.size() > options.count) {
+        page.documents.pop_back();
+        page.has_more = true;
+    }
+    return page;
+}
+
+template <typename ExecutionPolicy, EnableIfExecutionPolicy<ExecutionPolicy>>
+    std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query) const {
+    return FindTopDocuments(policy, raw_query, DocumentStatus::ACTUAL);
+}
+
+template <typename ExecutionPolicy, EnableIfExecutionPolicy<ExecutionPolicy>>
+    std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query, const DocumentStatus& status) const {
+    return FindTopDocuments(policy, raw_query, DocumentStatusSet(status));
+}
+
+template <typename DocumentPredicate>
+    bool SearchServer::AcceptsDocument(const DocumentPredicate& document_predicate, int document_index) const {
+        if constexpr (std::is_same_v<DocumentPredicate, DocumentStatusSet>) {
+            return (GetStatusWord(document_predicate, static_cast<size_t>(document_index) / 64) >> (document_index % 64)) & 1;
         } else {
-            return lhs.relevance > rhs.relevance;
+            const DocumentData& document_data = documents_[document_index];
+            return document_predicate(document_data.id, document_data.status, document_data.rating);
         }
-    });
-    if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
-        matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
     }
-    return matched_documents;
-}
 
 template <typename DocumentPredicate>
-    std::vector<Document> SearchServer::FindAllDocuments(const Query& query,
-                                      DocumentPredicate document_predicate) const {
+    int SearchServer::SkipRejectedDocuments(const DocumentPredicate& document_predicate, int document_index, int last_index) const {
+        if constexpr (std::is_same_v<DocumentPredicate, DocumentStatusSet>) {
+            return FindNextDocument(document_predicate, document_index + 1, last_index);
+        } else {
+            return document_index + 1;
+        }
+    }
+
+template <typename DocumentPredicate>
+    bool SearchServer::MayAcceptDocuments(const DocumentPredicate& document_predicate) const {
+        if constexpr (std::is_same_v<DocumentPredicate, DocumentStatusSet>) {
+            return GetDocumentCount(document_predicate) > 0;
+        } else {
+            return true;
+        }
+    }
+
+template <typename DocumentPredicate>
+    std::vector<Document> SearchServer::FindAllDocuments(const std::execution::sequenced_policy&, const Query& query,
+                                      DocumentPredicate document_predicate, const TopKOptions& options,
+                                      const CorpusStatistics* statistics) const {
+        ThreadScratch<QueryTerms> terms;
+        ResolveQuery(query, statistics, options.ranking, *terms);
+        return FindTopInRange(*terms, 0, static_cast<int>(documents_.size()), document_predicate, options);
+    }
+
+template <typename DocumentPredicate>
+    std::vector<Document> SearchServer::FindAllDocuments(const std::execution::parallel_policy&, const Query& query,
+                                      DocumentPredicate document_predicate, const TopKOptions& options,
+                                      const CorpusStatistics* statistics) const {
         using namespace std;
-        map<int, double> document_to_relevance;
-        for (const string& word : query.plus_words) {
-            if (word_to_document_freqs_.count(word) == 0) {
-                continue;
+        const auto run_shards = [](int shard_count, const auto& job) {
+            vector<int> shard_indexes(shard_count);
+            for (int i = 0; i < shard_count; ++i) {
+                shard_indexes[i] = i;
+            }
+            for_each(execution::par, shard_indexes.begin(), shard_indexes.end(), job);
+        };
+        return FindAllDocumentsSharded(run_shards, query, document_predicate, options, statistics);
+    }
+
+template <typename ShardRunner, typename DocumentPredicate>
+    std::vector<Document> SearchServer::FindAllDocumentsSharded(ShardRunner run_shards, const Query& query,
+                                                                DocumentPredicate document_predicate, const TopKOptions& options,
+                                                                const CorpusStatistics* statistics) const {
+        using namespace std;
+        ThreadScratch<QueryTerms> terms;
+        ResolveQuery(query, statistics, options.ranking, *terms);
+        const int document_count = static_cast<int>(documents_.size());
+        const int shard_count = min(document_count, static_cast<int>(max(1u, thread::hardware_concurrency()) * 4));
+        if (shard_count == 0) {
+            return {};
+        }
+        const int shard_width = (document_count - 1) / shard_count + 1;
+
+        vector<vector<Document>> shards(shard_count);
+        // Исключение из параллельного алгоритма вызвало бы std::terminate, поэтому ошибки
+        // шардов сохраняются и пробрасываются после завершения всех.
+        vector<exception_ptr> errors(shard_count);
+        run_shards(shard_count, [&](int shard_index) {
+            const int first_index = shard_index * shard_width;
+            const int last_index = min(first_index + shard_width, document_count);
+            try {
+                shards[shard_index] = FindTopInRange(*terms, first_index, last_index, document_predicate, options);
+            } catch (...) {
+                errors[shard_index] = current_exception();
+            }
+        });
+        for (const exception_ptr& error : errors) {
+            if (error) {
+                rethrow_exception(error);
+            }
+        }
+
+        StageTimer timer(SearchStage::MERGE);
+        TopDocumentsCollector top_documents(options.count, options.after);
+        for (const auto& shard_documents : shards) {
+            top_documents.Merge(shard_documents);
+        }
+        return top_documents.Extract();
+    }
+
+template <typename DocumentPredicate>
+    std::vector<Document> SearchServer::FindTopInRange(const QueryTerms& terms, int first_index, int last_index,
+                                                       DocumentPredicate document_predicate, const TopKOptions& options) const {
+        using namespace std;
+        TopDocumentsCollector top_documents(options.count, options.after);
+        if (!MayAcceptDocuments(document_predicate)) {
+            return {};
+        }
+        {
+            StageTimer timer(SearchStage::TRAVERSE);
+            QueryCounters counters;
+            DeadlineGuard deadline(options.deadline);
+            if (options.match == QueryMatch::ALL || !terms.phrases.empty()) {
+                CollectTopByIntersection(terms, options.match, first_index, last_index, document_predicate, top_documents,
+                                         counters, deadline);
+            } else if (options.mode == TopKMode::WAND) {
+                CollectTopByWand(terms, first_index, last_index, document_predicate, top_documents, counters, deadline);
+            } else {
+                ThreadScratch<RelevanceAccumulator> accumulator;
+                CollectRelevance(terms, first_index, last_index, document_predicate, *accumulator, top_documents, counters, deadline);
+            }
+        }
+        StageTimer timer(SearchStage::SELECT);
+        return top_documents.Extract();
+    }
+
+template <typename DocumentPredicate>
+    void SearchServer::CollectRelevance(const QueryTerms& terms, int first_index, int last_index, DocumentPredicate document_predicate,
+                                        RelevanceAccumulator& accumulator, TopDocumentsCollector& top_documents,
+                                        QueryCounters& counters, DeadlineGuard& deadline) const {
+        using namespace std;
+        accumulator.Reset(static_cast<size_t>(max(last_index - first_index, 0)));
+        if (first_index >= last_index) {
+            return;
+        }
+        auto& relevances = accumulator.relevances;
+        auto& marks = accumulator.marks;
+        auto& touched = accumulator.touched;
+        for (size_t i = 0; i < terms.plus_terms.size(); ++i) {
+            PostingCursor cursor = index_.GetCursor(terms.plus_terms[i]);
+            cursor.SkipTo(first_index);
+            while (!cursor.AtEnd() && cursor.GetDocument() < last_index) {
+                const int document_index = cursor.GetDocument();
+                const int slot = document_index - first_index;
+                counters.Add(SearchCounter::POSTINGS_VISITED);
+                deadline.Step();
+                // Предикат вызывается один раз на документ, при первом вхождении. Отвергнутый
+                // документ может позволить пропустить и следующие за ним (см. SkipRejectedDocuments).
+                if (marks[slot] == RelevanceAccumulator::UNTOUCHED) {
+                    if (!AcceptsDocument(document_predicate, document_index)) {
+                        marks[slot] = RelevanceAccumulator::EXCLUDED;
+                        touched.push_back(slot);
+                        cursor.SkipTo(SkipRejectedDocuments(document_predicate, document_index, last_index));
+                        continue;
+                    }
+                    marks[slot] = RelevanceAccumulator::CANDIDATE;
+                    touched.push_back(slot);
+                }
+                if (marks[slot] == RelevanceAccumulator::CANDIDATE) {
+                    relevances[slot] += terms.Score(i, cursor.GetTermFreq(), documents_[document_index].word_count);
+                }
+                cursor.Next();
             }
-            const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-            for (const auto &[document_id, term_freq] : word_to_document_freqs_.at(word)) {
-                const auto& document_data = documents_.at(document_id);
-                if (document_predicate(document_id, document_data.status, document_data.rating)) {
-                    document_to_relevance[document_id] += term_freq * inverse_document_freq;
+        }
+
+        {
+            StageTimer timer(SearchStage::MINUS_FILTER);
+            for (const TermId term_id : terms.minus_terms) {
+                PostingCursor cursor = index_.GetCursor(term_id);
+                for (cursor.SkipTo(first_index); !cursor.AtEnd() && cursor.GetDocument() < last_index; cursor.Next()) {
+                    counters.Add(SearchCounter::POSTINGS_VISITED);
+                    deadline.Step();
+                    const int slot = cursor.GetDocument() - first_index;
+                    if (marks[slot] == RelevanceAccumulator::CANDIDATE) {
+                        marks[slot] = RelevanceAccumulator::EXCLUDED;
+                        counters.Add(SearchCounter::MINUS_WORD_EXCLUSIONS);
+                    }
                 }
             }
         }
 
-        for (const string& word : query.minus_words) {
-            if (word_to_document_freqs_.count(word) == 0) {
-                continue;
+        // Кандидаты передаются в порядке индексов, как раньше из std::map: при равной с точностью
+        // до epsilon релевантности выдача не зависит от порядка обхода списков.
+        const auto add_candidate = [&](int slot) {
+            if (marks[slot] == RelevanceAccumulator::CANDIDATE) {
+                const DocumentData& document_data = documents_[first_index + slot];
+                counters.Add(SearchCounter::CANDIDATES_SCORED);
+                top_documents.Add({document_data.id, relevances[slot], document_data.rating});
             }
-            for (const auto &[document_id, _] : word_to_document_freqs_.at(word)) {
-                document_to_relevance.erase(document_id);
+        };
+        if (touched.size() * RelevanceAccumulator::SCAN_RATIO >= static_cast<size_t>(last_index - first_index)) {
+            for (int slot = 0; slot < last_index - first_index; ++slot) {
+                add_candidate(slot);
             }
+        } else {
+            sort(touched.begin(), touched.end());
+            for_each(touched.begin(), touched.end(), add_candidate);
         }
+    }
+
+template <typename ExecutionPolicy>
+    void SearchServer::RemoveDocumentImpl(ExecutionPolicy&& policy, int document_id) {
+        using namespace std;
+        const auto index_it = document_id_to_index_.find(document_id);
+        if (index_it == document_id_to_index_.end()) {
+            return;
+        }
+        const int document_index = index_it->second;
+        DocumentData& document_data = documents_[document_index];
+        for_each(policy, document_data.term_ids.begin(), document_data.term_ids.end(), [this, document_index](TermId term_id) {
+            index_.RemovePosting(term_id, document_index);
+        });
+
+        document_data.is_alive = false;
+        ClearStatusBit(document_index, document_data.status);
+        document_data.term_ids = {};
+        document_data.term_freqs = {};
+        document_data.position_offsets = {};
+        document_data.positions = {};
+        total_word_count_ -= document_data.word_count;
+        document_id_to_index_.erase(index_it);
+        document_ids_.erase(document_id);
+        ++generation_;
+    }
+
+template <typename DocumentPredicate>
+    void SearchServer::CollectTopByWand(const QueryTerms& terms, int first_index, int last_index, DocumentPredicate document_predicate,
+                                        TopDocumentsCollector& top_documents, QueryCounters& counters,
+                                        DeadlineGuard& deadline) const {
+        using namespace std;
+        // Запас на разный порядок сложения верхних границ и настоящей релевантности
+        // плюс epsilon, в пределах которого CompareDocuments сравнивает рейтинг.
+        const double score_slack = 1e-9;
 
-        vector<Document> matched_documents;
-        for (const auto &[document_id, relevance] : document_to_relevance) {
-            matched_documents.push_back(
-                {document_id, relevance, documents_.at(document_id).rating});
+        struct Cursor {
+            size_t term;
+            PostingCursor postings;
+            double max_score;
+        };
+
+        // Курсоры не перемещаются: сортируются и удаляются только указатели на них.
+        deque<Cursor> cursor_storage;
+        vector<Cursor*> cursors;
+        for (size_t i = 0; i < terms.plus_terms.size(); ++i) {
+            const TermId term_id = terms.plus_terms[i];
+            cursor_storage.push_back({i, index_.GetCursor(term_id), terms.MaxScore(i, index_.GetPostings(term_id).GetMaxTermFreq())});
+            Cursor& cursor = cursor_storage.back();
+            cursor.postings.SkipTo(first_index);
+            if (!cursor.postings.AtEnd() && cursor.postings.GetDocument() < last_index) {
+                cursors.push_back(&cursor);
+            }
         }
-        return matched_documents;
-    }
\ No newline at end of file
+
+        MinusWordsFilter minus_words_filter(index_, terms.minus_terms);
+        const auto current_document = [](const Cursor* cursor) {
+            return cursor->postings.GetDocument();
+        };
+
+        vector<double> contributions(terms.plus_terms.size());
+        while (!cursors.empty()) {
+            deadline.Step();
+            sort(cursors.begin(), cursors.end(), [&](const Cursor* lhs, const Cursor* rhs) {
+                return current_document(lhs) < current_document(rhs);
+            });
+
+            size_t pivot = 0;
+            if (top_documents.IsFull()) {
+                const double threshold = top_documents.GetWorst().relevance;
+                double upper_bound = 0.0;
+                while (pivot < cursors.size()) {
+                    upper_bound += cursors[pivot]->max_score;
+                    if (upper_bound + score_slack >= threshold) {
+                        break;
+                    }
+                    ++pivot;
+                }
+                if (pivot == cursors.size()) {
+                    break;
+                }
+            }
+            const int pivot_document = current_document(cursors[pivot]);
+
+            if (current_document(cursors[0]) == pivot_document && !AcceptsDocument(document_predicate, pivot_document)) {
+                // Документы до следующего подходящего не пройдут предикат, их можно перешагнуть.
+                const int next_document = SkipRejectedDocuments(document_predicate, pivot_document, last_index);
+                for (Cursor* cursor : cursors) {
+                    if (current_document(cursor) >= next_document) {
+                        break;
+                    }
+                    cursor->postings.SkipTo(next_document);
+                }
+            } else if (current_document(cursors[0]) == pivot_document) {
+                const DocumentData& document_data = documents_[pivot_document];
+                if (minus_words_filter.IsExcluded(pivot_document)) {
+                    counters.Add(SearchCounter::MINUS_WORD_EXCLUSIONS);
+                } else {
+                    // Вклады складываются в порядке слов запроса, как в CollectRelevance,
+                    // чтобы релевантность совпадала бит в бит; нулевой вклад сумму не меняет.
+                    fill(contributions.begin(), contributions.end(), 0.0);
+                    for (const Cursor* cursor : cursors) {
+                        if (current_document(cursor) != pivot_document) {
+                            break;
+                        }
+                        contributions[cursor->term] = terms.Score(cursor->term, cursor->postings.GetTermFreq(), document_data.word_count);
+                    }
+                    double relevance = 0.0;
+                    for (const double contribution : contributions) {
+                        relevance += contribution;
+                    }
+                    counters.Add(SearchCounter::CANDIDATES_SCORED);
+                    top_documents.Add({document_data.id, relevance, document_data.rating});
+                }
+                for (Cursor* cursor : cursors) {
+                    if (current_document(cursor) != pivot_document) {
+                        break;
+                    }
+                    counters.Add(SearchCounter::POSTINGS_VISITED);
+                    cursor->postings.Next();
+                }
+            } else {
+                for (size_t i = 0; i < pivot; ++i) {
+                    cursors[i]->postings.SkipTo(pivot_document);
+                }
+            }
+            cursors.erase(remove_if(cursors.begin(), cursors.end(), [last_index](const Cursor* cursor) {
+                return cursor->postings.AtEnd() || cursor->postings.GetDocument() >= last_index;
+            }), cursors.end());
+        }
+    }
+
+template <typename DocumentPredicate>
+    void SearchServer::CollectTopByIntersection(const QueryTerms& terms, QueryMatch match, int first_index, int last_index,
+                                                DocumentPredicate document_predicate, TopDocumentsCollector& top_documents,
+                                                QueryCounters& counters, DeadlineGuard& deadline) const {
+        using namespace std;
+        if (match == QueryMatch::ALL && !terms.all_plus_words_found) {
+            return;
+        }
+        vector<TermId> required_terms;
+        if (match == QueryMatch::ALL) {
+            required_terms = terms.plus_terms;
+        }
+        for (const auto& phrase : terms.phrases) {
+            required_terms.insert(required_terms.end(), phrase.begin(), phrase.end());
+        }
+        sort(required_terms.begin(), required_terms.end());
+        required_terms.erase(unique(required_terms.begin(), required_terms.end()), required_terms.end());
+        if (required_terms.empty() || required_terms.front() == InvertedIndex::NO_TERM) {
+            return;
+        }
+        sort(required_terms.begin(), required_terms.end(), [this](TermId lhs, TermId rhs) {
+            return index_.GetPostings(lhs).size() < index_.GetPostings(rhs).size();
+        });
+
+        // Ведущий курсор идёт по самому короткому списку, остальные догоняют его через SkipTo;
+        // при несовпадении ведущий перескакивает к документу, на котором остановился отставший.
+        deque<PostingCursor> cursors;
+        for (const TermId term_id : required_terms) {
+            cursors.push_back(index_.GetCursor(term_id));
+        }
+        MinusWordsFilter minus_words_filter(index_, terms.minus_terms);
+        PostingCursor& lead = cursors.front();
+        lead.SkipTo(first_index);
+        while (!lead.AtEnd() && lead.GetDocument() < last_index) {
+            const int document_index = lead.GetDocument();
+            counters.Add(SearchCounter::POSTINGS_VISITED);
+            deadline.Step();
+            int next_document = document_index;
+            for (size_t i = 1; i < cursors.size() && next_document == document_index; ++i) {
+                cursors[i].SkipTo(document_index);
+                if (cursors[i].AtEnd()) {
+                    return;
+                }
+                next_document = cursors[i].GetDocument();
+            }
+            if (next_document != document_index) {
+                lead.SkipTo(next_document);
+                continue;
+            }
+
+            if (!AcceptsDocument(document_predicate, document_index)) {
+                lead.SkipTo(SkipRejectedDocuments(document_predicate, document_index, last_index));
+                continue;
+            }
+            const DocumentData& document_data = documents_[document_index];
+            if (minus_words_filter.IsExcluded(document_index)) {
+                counters.Add(SearchCounter::MINUS_WORD_EXCLUSIONS);
+            } else if (all_of(terms.phrases.begin(), terms.phrases.end(), [&document_data](const vector<TermId>& phrase) {
+                       return ContainsPhrase(document_data, phrase);
+                   })) {
+                // Вклады складываются в порядке слов запроса, как в CollectRelevance.
+                double relevance = 0.0;
+                for (size_t i = 0; i < terms.plus_terms.size(); ++i) {
+                    const int slot = FindDocumentTerm(document_data, terms.plus_terms[i]);
+                    if (slot >= 0) {
+                        relevance += terms.Score(i, document_data.term_freqs[slot], document_data.word_count);
+                    }
+                }
+                counters.Add(SearchCounter::CANDIDATES_SCORED);
+                top_documents.Add({document_data.id, relevance, document_data.rating});
+            }
+            lead.Next();
+        }
+    }
@@ -0,0 +1,364 @@
+#include "search_shard.h"
+#include "stream_protocol.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstdlib>
+#include <limits>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+string_view NextToken(string_view& text) {
+    const size_t begin = text.find_first_not_of(' ');
+    if (begin == string_view::npos) {
+        text = {};
+        return {};
+    }
+    text.remove_prefix(begin);
+    const size_t end = min(text.find(' '), text.size());
+    const string_view token = text.substr(0, end);
+    text.remove_prefix(end);
+    return token;
+}
+
+template <typename Number>
+Number ParseNumber(string_view token) {
+    Number value = 0;
+    const auto [end, error] = from_chars(token.data(), token.data() + token.size(), value);
+    if (token.empty() || error != errc() || end != token.data() + token.size()) {
+        throw runtime_error("Invalid number in shard reply: " + string(token));
+    }
+    return value;
+}
+
+double ParseRelevance(string_view token) {
+    const string text(token);
+    char* end = nullptr;
+    const double value = strtod(text.c_str(), &end);
+    if (text.empty() || end != text.c_str() + text.size()) {
+        throw runtime_error("Invalid relevance in shard reply: " + text);
+    }
+    return value;
+}
+
+string_view GetTopKModeName(TopKMode mode) {
+    return mode == TopKMode::WAND ? "WAND" : "EXHAUSTIVE";
+}
+
+string_view GetQueryMatchName(QueryMatch match) {
+    return match == QueryMatch::ALL ? "ALL" : "ANY";
+}
+
+string_view GetRankingModelName(RankingModel ranking) {
+    return ranking == RankingModel::BM25 ? "BM25" : "TF_IDF";
+}
+
+// Перевод строки разорвал бы команду на две и сбил очередь ответов.
+string_view CheckQueryLine(string_view raw_query) {
+    if (raw_query.find_first_of("\r\n") != string_view::npos) {
+        throw invalid_argument("There are invalid characters in the words of the search query"s);
+    }
+    return raw_query;
+}
+
+void AppendStatuses(string& command, DocumentStatusSet statuses) {
+    bool first = true;
+    for (int status = 0; status < DOCUMENT_STATUS_COUNT; ++status) {
+        if (statuses.Contains(static_cast<DocumentStatus>(status))) {
+            if (!first) {
+                command += ',';
+            }
+            command += GetDocumentStatusName(static_cast<DocumentStatus>(status));
+            first = false;
+        }
+    }
+}
+
+}  // namespace
+
+LocalShard::LocalShard(string_view stop_words_text)
+        : search_server_(stop_words_text) {
+}
+
+void LocalShard::AddDocuments(const vector<RawDocument>& documents) {
+    search_server_.AddDocuments(documents);
+}
+
+void LocalShard::RemoveDocument(int document_id) {
+    search_server_.RemoveDocument(document_id);
+}
+
+tuple<vector<string>, DocumentStatus> LocalShard::MatchDocument(string_view raw_query, int document_id) {
+    const auto [words, status] = search_server_.MatchDocument(raw_query, document_id);
+    return {vector<string>(words.begin(), words.end()), status};
+}
+
+void LocalShard::SendStatisticsRequest(string_view raw_query) {
+    try {
+        statistics_ = search_server_.GetCorpusStatistics(raw_query);
+    } catch (...) {
+        error_ = current_exception();
+    }
+}
+
+CorpusStatistics LocalShard::ReceiveStatistics() {
+    if (error_) {
+        rethrow_exception(exchange(error_, nullptr));
+    }
+    return move(statistics_);
+}
+
+void LocalShard::SendFindRequest(string_view raw_query, DocumentStatusSet statuses, const TopKOptions& options,
+                                 const CorpusStatistics& statistics) {
+    try {
+        documents_ = search_server_.FindTopDocuments(execution::seq, raw_query, statuses, options, statistics);
+    } catch (...) {
+        error_ = current_exception();
+    }
+}
+
+vector<Document> LocalShard::ReceiveDocuments() {
+    if (error_) {
+        rethrow_exception(exchange(error_, nullptr));
+    }
+    return move(documents_);
+}
+
+#ifndef _WIN32
+
+ProcessShard::ProcessShard(string_view stop_words_text) {
+    int sockets[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) != 0) {
+        throw system_error(errno, generic_category(), "cannot create shard socket");
+    }
+    const pid_t process_id = fork();
+    if (process_id < 0) {
+        const int error = errno;
+        close(sockets[0]);
+        close(sockets[1]);
+        throw system_error(error, generic_category(), "cannot start shard process");
+    }
+    if (process_id == 0) {
+        // Сокеты ранее созданных шардов, унаследованные дочерним процессом, не дали бы
+        // их процессам увидеть конец ввода, когда родитель закроет свою сторону.
+        const long max_fd = sysconf(_SC_OPEN_MAX);
+        for (int fd = 3; fd < min(max_fd > 0 ? max_fd : 1024L, 1L << 16); ++fd) {
+            if (fd != sockets[1]) {
+                close(fd);
+            }
+        }
+        int exit_code = 0;
+        try {
+            SearchServer search_server(stop_words_text);
+            ServeStream(search_server, sockets[1], sockets[1]);
+        } catch (...) {
+            exit_code = 1;
+        }
+        _exit(exit_code);
+    }
+    close(sockets[1]);
+    socket_fd_ = sockets[0];
+    process_id_ = process_id;
+}
+
+ProcessShard::~ProcessShard() {
+    // Конец ввода завершает ServeStream в дочернем процессе.
+    close(socket_fd_);
+    while (waitpid(process_id_, nullptr, 0) < 0 && errno == EINTR) {
+    }
+}
+
+void ProcessShard::Send(const string& commands) {
+#ifdef MSG_NOSIGNAL
+    const int flags = MSG_NOSIGNAL;
+#else
+    const int flags = 0;
+#endif
+    size_t sent = 0;
+    while (sent < commands.size()) {
+        const auto result = send(socket_fd_, commands.data() + sent, commands.size() - sent, flags);
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw system_error(errno, generic_category(), "cannot send command to shard process");
+        }
+        sent += static_cast<size_t>(result);
+    }
+}
+
+string ProcessShard::ReceiveReply() {
+    size_t end = input_buffer_.find('\n');
+    while (end == string::npos) {
+        char buffer[1 << 16];
+        const auto result = recv(socket_fd_, buffer, sizeof(buffer), 0);
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw system_error(errno, generic_category(), "cannot receive reply from shard process");
+        }
+        if (result == 0) {
+            throw runtime_error("shard process closed the connection");
+        }
+        const size_t searched = input_buffer_.size();
+        input_buffer_.append(buffer, static_cast<size_t>(result));
+        end = input_buffer_.find('\n', searched);
+    }
+    string reply = input_buffer_.substr(0, end);
+    input_buffer_.erase(0, end + 1);
+
+    string_view arguments = reply;
+    const string_view result = NextToken(arguments);
+    arguments.remove_prefix(min(arguments.find_first_not_of(' '), arguments.size()));
+    if (result == "error") {
+        throw invalid_argument(string(arguments));
+    }
+    if (result != "ok") {
+        throw runtime_error("Unexpected shard reply: " + reply);
+    }
+    return string(arguments);
+}
+
+#else
+
+ProcessShard::ProcessShard(string_view) {
+    throw runtime_error("process shards are not supported on this platform");
+}
+
+ProcessShard::~ProcessShard() = default;
+
+void ProcessShard::Send(const string&) {
+}
+
+string ProcessShard::ReceiveReply() {
+    return {};
+}
+
+#endif
+
+void ProcessShard::AddDocuments(const vector<RawDocument>& documents) {
+    string commands;
+    for (size_t begin = 0; begin < documents.size(); begin += MAX_PIPELINED_ADDS) {
+        const size_t end = min(begin + MAX_PIPELINED_ADDS, documents.size());
+        commands.clear();
+        for (size_t i = begin; i < end; ++i) {
+            const RawDocument& document = documents[i];
+            commands += "add ";
+            commands += to_string(document.id);
+            commands += ' ';
+            commands += GetDocumentStatusName(document.status);
+            for (const int rating : document.ratings) {
+                commands += ' ';
+                commands += to_string(rating);
+            }
+            commands += " -- ";
+            commands += document.text;
+            commands += '\n';
+        }
+        Send(commands);
+        // Ответ читается на каждую команду, чтобы не сбить очередь ответов.
+        exception_ptr error;
+        for (size_t i = begin; i < end; ++i) {
+            try {
+                ReceiveReply();
+            } catch (const invalid_argument&) {
+                if (!error) {
+                    error = current_exception();
+                }
+            }
+        }
+        if (error) {
+            rethrow_exception(error);
+        }
+    }
+}
+
+void ProcessShard::RemoveDocument(int document_id) {
+    Send("remove " + to_string(document_id) + '\n');
+    ReceiveReply();
+}
+
+tuple<vector<string>, DocumentStatus> ProcessShard::MatchDocument(string_view raw_query, int document_id) {
+    Send("match " + to_string(document_id) + ' ' + string(CheckQueryLine(raw_query)) + '\n');
+    const string reply = ReceiveReply();
+    string_view arguments = reply;
+    const DocumentStatus status = ParseDocumentStatus(NextToken(arguments));
+    vector<string> words;
+    for (string_view word = NextToken(arguments); !word.empty(); word = NextToken(arguments)) {
+        words.emplace_back(word);
+    }
+    return {move(words), status};
+}
+
+void ProcessShard::SendStatisticsRequest(string_view raw_query) {
+    Send("stats " + string(CheckQueryLine(raw_query)) + '\n');
+}
+
+CorpusStatistics ProcessShard::ReceiveStatistics() {
+    const string reply = ReceiveReply();
+    string_view arguments = reply;
+    CorpusStatistics statistics;
+    statistics.document_count = ParseNumber<int>(NextToken(arguments));
+    statistics.word_count = ParseNumber<int64_t>(NextToken(arguments));
+    for (int i = ParseNumber<int>(NextToken(arguments)); i > 0; --i) {
+        const string_view word = NextToken(arguments);
+        statistics.document_freqs.emplace(word, ParseNumber<int>(NextToken(arguments)));
+    }
+    return statistics;
+}
+
+void ProcessShard::SendFindRequest(string_view raw_query, DocumentStatusSet statuses, const TopKOptions& options,
+                                   const CorpusStatistics& statistics) {
+    CheckQueryLine(raw_query);
+    string command = "shardfind ";
+    AppendStatuses(command, statuses);
+    command += ' ';
+    command += to_string(min<size_t>(options.count, numeric_limits<int>::max()));
+    command += ' ';
+    command += GetTopKModeName(options.mode);
+    command += ' ';
+    command += GetQueryMatchName(options.match);
+    command += ' ';
+    command += GetRankingModelName(options.ranking);
+    command += ' ';
+    command += to_string(statistics.document_count);
+    command += ' ';
+    command += to_string(statistics.word_count);
+    command += ' ';
+    command += to_string(statistics.document_freqs.size());
+    for (const auto& [word, document_freq] : statistics.document_freqs) {
+        command += ' ';
+        command += word;
+        command += ' ';
+        command += to_string(document_freq);
+    }
+    command += " -- ";
+    command += raw_query;
+    command += '\n';
+    Send(command);
+}
+
+vector<Document> ProcessShard::ReceiveDocuments() {
+    const string reply = ReceiveReply();
+    string_view arguments = reply;
+    vector<Document> documents(ParseNumber<size_t>(NextToken(arguments)));
+    for (Document& document : documents) {
+        document.id = ParseNumber<int>(NextToken(arguments));
+        document.relevance = ParseRelevance(NextToken(arguments));
+        document.rating = ParseNumber<int>(NextToken(arguments));
+    }
+    return documents;
+}
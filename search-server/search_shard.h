@@ -0,0 +1,88 @@
+#pragma once
+
+#include "search_server.h"
+
+#include <exception>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+// Часть корпуса ShardedSearchServer. Запросы статистики и поиска разделены на отправку
+// и получение ответа, чтобы запрос можно было разослать всем шардам до ожидания первого ответа.
+// На каждый Send* должен приходиться ровно один Receive*, даже если предыдущий бросил исключение.
+class SearchShard {
+public:
+    virtual ~SearchShard() = default;
+
+    virtual void AddDocuments(const std::vector<RawDocument>& documents) = 0;
+    virtual void RemoveDocument(int document_id) = 0;
+    virtual std::tuple<std::vector<std::string>, DocumentStatus> MatchDocument(std::string_view raw_query, int document_id) = 0;
+
+    virtual void SendStatisticsRequest(std::string_view raw_query) = 0;
+    virtual CorpusStatistics ReceiveStatistics() = 0;
+
+    // IDF считается по statistics, а не по документам шарда.
+    virtual void SendFindRequest(std::string_view raw_query, DocumentStatusSet statuses, const TopKOptions& options,
+                                 const CorpusStatistics& statistics) = 0;
+    // Документы в порядке CompareDocuments.
+    virtual std::vector<Document> ReceiveDocuments() = 0;
+};
+
+// Шард в том же процессе. Запрос выполняется сразу при отправке.
+class LocalShard : public SearchShard {
+public:
+    explicit LocalShard(std::string_view stop_words_text);
+
+    void AddDocuments(const std::vector<RawDocument>& documents) override;
+    void RemoveDocument(int document_id) override;
+    std::tuple<std::vector<std::string>, DocumentStatus> MatchDocument(std::string_view raw_query, int document_id) override;
+
+    void SendStatisticsRequest(std::string_view raw_query) override;
+    CorpusStatistics ReceiveStatistics() override;
+    void SendFindRequest(std::string_view raw_query, DocumentStatusSet statuses, const TopKOptions& options,
+                         const CorpusStatistics& statistics) override;
+    std::vector<Document> ReceiveDocuments() override;
+
+private:
+    SearchServer search_server_;
+    CorpusStatistics statistics_;
+    std::vector<Document> documents_;
+    // Ошибка выполнения отложенного запроса, бросается из Receive*.
+    std::exception_ptr error_;
+};
+
+// Шард в дочернем процессе: свой SearchServer, обслуживаемый ServeStream через пару сокетов.
+// Процесс порождается fork без exec, поэтому создавать такие шарды нужно до запуска потоков
+// и параллельных алгоритмов. Только POSIX; на других платформах конструктор бросает runtime_error.
+class ProcessShard : public SearchShard {
+public:
+    explicit ProcessShard(std::string_view stop_words_text);
+    ~ProcessShard() override;
+
+    ProcessShard(const ProcessShard&) = delete;
+    ProcessShard& operator=(const ProcessShard&) = delete;
+
+    void AddDocuments(const std::vector<RawDocument>& documents) override;
+    void RemoveDocument(int document_id) override;
+    std::tuple<std::vector<std::string>, DocumentStatus> MatchDocument(std::string_view raw_query, int document_id) override;
+
+    void SendStatisticsRequest(std::string_view raw_query) override;
+    CorpusStatistics ReceiveStatistics() override;
+    void SendFindRequest(std::string_view raw_query, DocumentStatusSet statuses, const TopKOptions& options,
+                         const CorpusStatistics& statistics) override;
+    std::vector<Document> ReceiveDocuments() override;
+
+private:
+    // Больше команд add за раз не отправляется: ответы на них должны поместиться
+    // в буфер сокета, пока родитель ещё пишет.
+    static constexpr size_t MAX_PIPELINED_ADDS = 1024;
+
+    void Send(const std::string& commands);
+    // Аргументы ответа "ok ..."; ответ "error <сообщение>" бросается как invalid_argument.
+    std::string ReceiveReply();
+
+    int socket_fd_ = -1;
+    int process_id_ = -1;
+    std::string input_buffer_;
+};
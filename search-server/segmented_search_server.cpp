@@ -0,0 +1,254 @@
+#include "segmented_search_server.h"
+
+#include <algorithm>
+
+using namespace std;
+
+SegmentedSearchServer::SegmentedSearchServer(string_view stop_words_text, size_t memtable_capacity, size_t max_segment_count)
+        : stop_words_text_(stop_words_text)
+        , memtable_capacity_(max<size_t>(memtable_capacity, 1))
+        , max_segment_count_(max<size_t>(max_segment_count, 1))
+        , tokenizer_(stop_words_text_)
+        , memtable_(make_shared<Memtable>(stop_words_text_))
+        , segments_(make_shared<SegmentMap>()) {
+    compaction_thread_ = thread([this] { RunCompaction(); });
+}
+
+SegmentedSearchServer::~SegmentedSearchServer() {
+    {
+        lock_guard lock(mutex_);
+        stopping_ = true;
+    }
+    compaction_condition_.notify_all();
+    compaction_thread_.join();
+}
+
+void SegmentedSearchServer::AddDocument(int document_id, string_view document, DocumentStatus status, const vector<int>& ratings) {
+    const PreparedDocument prepared = tokenizer_.PrepareDocument(document_id, document, status, ratings);
+    lock_guard lock(mutex_);
+    if (document_segments_.count(document_id)) {
+        throw invalid_argument("attempt to add a document with the id of a previously added document"s);
+    }
+    size_t memtable_size = 0;
+    {
+        lock_guard memtable_lock(memtable_->mutex);
+        memtable_->server.AddPreparedDocument(prepared);
+        memtable_size = static_cast<size_t>(memtable_->server.GetDocumentCount());
+    }
+    document_segments_.emplace(document_id, memtable_segment_id_);
+    if (memtable_size >= memtable_capacity_) {
+        FlushMemtable();
+    }
+}
+
+void SegmentedSearchServer::RemoveDocument(int document_id) {
+    lock_guard lock(mutex_);
+    const auto segment_it = document_segments_.find(document_id);
+    if (segment_it == document_segments_.end()) {
+        return;
+    }
+    const int segment_id = segment_it->second;
+    document_segments_.erase(segment_it);
+
+    if (segment_id == memtable_segment_id_) {
+        lock_guard memtable_lock(memtable_->mutex);
+        memtable_->server.RemoveDocument(document_id);
+        return;
+    }
+    // Копия набора удалений стоит O(удалённых в сегменте): сегмент, где их больше половины, переписывается.
+    auto segments = make_shared<SegmentMap>(*segments_);
+    Segment& segment = segments->at(segment_id);
+    auto deletions = make_shared<SegmentDeletions>(*segment.deletions);
+    deletions->ids.insert(document_id);
+    deletions->word_count += segment.server->GetDocumentWordCount(document_id);
+    for (const auto& [word, term_freq] : segment.server->GetWordFrequencies(document_id)) {
+        ++deletions->document_freqs[string(word)];
+    }
+    segment.deletions = move(deletions);
+    segments_ = move(segments);
+    // Сегмент, где удалено больше половины документов, переписывается.
+    compaction_condition_.notify_one();
+}
+
+vector<Document> SegmentedSearchServer::FindTopDocuments(string_view raw_query, DocumentStatus status) const {
+    return FindTopDocuments(raw_query, DocumentStatusSet(status));
+}
+
+vector<Document> SegmentedSearchServer::FindTopDocuments(string_view raw_query) const {
+    return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
+}
+
+tuple<vector<string>, DocumentStatus> SegmentedSearchServer::MatchDocument(string_view raw_query, int document_id) const {
+    shared_ptr<Memtable> memtable;
+    shared_ptr<const SearchServer> segment_server;
+    {
+        lock_guard lock(mutex_);
+        const int segment_id = document_segments_.at(document_id);
+        if (segment_id == memtable_segment_id_) {
+            memtable = memtable_;
+        } else {
+            segment_server = segments_->at(segment_id).server;
+        }
+    }
+    if (memtable) {
+        lock_guard memtable_lock(memtable->mutex);
+        const auto [words, status] = memtable->server.MatchDocument(raw_query, document_id);
+        return {vector<string>(words.begin(), words.end()), status};
+    }
+    const auto [words, status] = segment_server->MatchDocument(raw_query, document_id);
+    return {vector<string>(words.begin(), words.end()), status};
+}
+
+int SegmentedSearchServer::GetDocumentCount() const {
+    lock_guard lock(mutex_);
+    return static_cast<int>(document_segments_.size());
+}
+
+size_t SegmentedSearchServer::GetSegmentCount() const {
+    lock_guard lock(mutex_);
+    return segments_->size();
+}
+
+void SegmentedSearchServer::Compact() {
+    while (CompactSegments()) {
+    }
+}
+
+CorpusStatistics SegmentedSearchServer::GetSegmentStatistics(const SegmentMap& segments, string_view raw_query) {
+    CorpusStatistics statistics;
+    for (const auto& [segment_id, segment] : segments) {
+        const SegmentDeletions& deletions = *segment.deletions;
+        CorpusStatistics segment_statistics = segment.server->GetCorpusStatistics(raw_query);
+        segment_statistics.document_count -= static_cast<int>(deletions.ids.size());
+        segment_statistics.word_count -= deletions.word_count;
+        for (auto& [word, document_freq] : segment_statistics.document_freqs) {
+            const auto deleted_it = deletions.document_freqs.find(word);
+            if (deleted_it != deletions.document_freqs.end()) {
+                document_freq -= deleted_it->second;
+            }
+        }
+        statistics.Merge(segment_statistics);
+    }
+    return statistics;
+}
+
+// Уровень сегмента — сколько раз его живые документы превосходят memtable в SEGMENT_MERGE_FACTOR раз.
+// Сливается первый уровень, набравший SEGMENT_MERGE_FACTOR сегментов. Если уровни не заполнены,
+// а сегментов больше max_segment_count_, сливаются самые маленькие.
+vector<int> SegmentedSearchServer::SelectSegmentsToMerge() const {
+    map<int, vector<int>> tier_segments;
+    vector<pair<size_t, int>> segment_sizes;
+    for (const auto& [segment_id, segment] : *segments_) {
+        const size_t document_count = static_cast<size_t>(segment.server->GetDocumentCount());
+        const size_t deleted_count = segment.deletions->ids.size();
+        if (deleted_count * 2 > document_count) {
+            return {segment_id};
+        }
+        const size_t live_count = document_count - deleted_count;
+        int tier = 0;
+        for (size_t size = live_count; size >= memtable_capacity_ * SEGMENT_MERGE_FACTOR; size /= SEGMENT_MERGE_FACTOR) {
+            ++tier;
+        }
+        tier_segments[tier].push_back(segment_id);
+        segment_sizes.emplace_back(live_count, segment_id);
+    }
+    for (const auto& [tier, segment_ids] : tier_segments) {
+        if (segment_ids.size() >= SEGMENT_MERGE_FACTOR) {
+            return segment_ids;
+        }
+    }
+    if (segments_->size() <= max_segment_count_) {
+        return {};
+    }
+    const size_t merge_count = min(SEGMENT_MERGE_FACTOR, segment_sizes.size());
+    partial_sort(segment_sizes.begin(), segment_sizes.begin() + merge_count, segment_sizes.end());
+    vector<int> segment_ids;
+    for (size_t i = 0; i < merge_count; ++i) {
+        segment_ids.push_back(segment_sizes[i].second);
+    }
+    return segment_ids;
+}
+
+// Вызывается под mutex_. Запрос, успевший взять указатель на прежний memtable, дочитывает
+// его как memtable: в его копии списка сегментов нового сегмента ещё нет.
+void SegmentedSearchServer::FlushMemtable() {
+    {
+        lock_guard memtable_lock(memtable_->mutex);
+        memtable_->server.CompactIndex();
+    }
+    auto segments = make_shared<SegmentMap>(*segments_);
+    segments->emplace(memtable_segment_id_, Segment{shared_ptr<const SearchServer>(memtable_, &memtable_->server),
+                                                    make_shared<const SegmentDeletions>()});
+    segments_ = move(segments);
+    memtable_ = make_shared<Memtable>(stop_words_text_);
+    memtable_segment_id_ = next_segment_id_++;
+    compaction_condition_.notify_one();
+}
+
+// Новый сегмент собирается без блокировки по копии списка сегментов. Документы, удалённые
+// за время слияния, помечаются удалёнными уже в новом сегменте.
+bool SegmentedSearchServer::CompactSegments() {
+    lock_guard compaction_lock(compaction_mutex_);
+
+    SegmentMap merged_segments;
+    {
+        lock_guard lock(mutex_);
+        for (const int segment_id : SelectSegmentsToMerge()) {
+            merged_segments.emplace(segment_id, segments_->at(segment_id));
+        }
+        if (merged_segments.empty()) {
+            return false;
+        }
+    }
+
+    auto merged_server = make_shared<SearchServer>(stop_words_text_);
+    for (const auto& [segment_id, segment] : merged_segments) {
+        for (const int document_id : *segment.server) {
+            if (segment.deletions->ids.count(document_id) == 0) {
+                merged_server->AddDocumentCopy(*segment.server, document_id);
+            }
+        }
+    }
+    merged_server->CompactIndex();
+
+    lock_guard lock(mutex_);
+    auto segments = make_shared<SegmentMap>(*segments_);
+    auto merged_deletions = make_shared<SegmentDeletions>();
+    const int merged_segment_id = next_segment_id_++;
+    for (const auto& [segment_id, old_segment] : merged_segments) {
+        for (const int document_id : segments->at(segment_id).deletions->ids) {
+            if (old_segment.deletions->ids.count(document_id) == 0) {
+                merged_deletions->ids.insert(document_id);
+                merged_deletions->word_count += merged_server->GetDocumentWordCount(document_id);
+                for (const auto& [word, term_freq] : merged_server->GetWordFrequencies(document_id)) {
+                    ++merged_deletions->document_freqs[string(word)];
+                }
+            }
+        }
+        for (const int document_id : *old_segment.server) {
+            const auto segment_it = document_segments_.find(document_id);
+            if (segment_it != document_segments_.end() && segment_it->second == segment_id) {
+                segment_it->second = merged_segment_id;
+            }
+        }
+        segments->erase(segment_id);
+    }
+    if (merged_server->GetDocumentCount() > 0) {
+        segments->emplace(merged_segment_id, Segment{move(merged_server), move(merged_deletions)});
+    }
+    segments_ = move(segments);
+    return true;
+}
+
+void SegmentedSearchServer::RunCompaction() {
+    while (true) {
+        {
+            unique_lock lock(mutex_);
+            compaction_condition_.wait(lock, [this] { return stopping_ || !SelectSegmentsToMerge().empty(); });
+            if (stopping_) {
+                return;
+            }
+        }
+        CompactSegments();
+    }
+}
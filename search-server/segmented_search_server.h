@@ -0,0 +1,147 @@
+#pragma once
+
+#include "search_server.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+const size_t DEFAULT_MEMTABLE_CAPACITY = 4096;
+const size_t DEFAULT_MAX_SEGMENT_COUNT = 8;
+
+// Индекс из неизменяемых сегментов и небольшого изменяемого (memtable) в стиле LSM.
+// Новые документы попадают в memtable; заполненный memtable становится неизменяемым сегментом.
+// Удаление из сегмента только помечает документ. Фоновое слияние многоуровневое: сегменты
+// близкого размера (одного уровня) сливаются, когда их набирается SEGMENT_MERGE_FACTOR, поэтому
+// каждый документ переписывается O(log N) раз; помеченные документы при этом отбрасываются. Запрос выполняется на каждом сегменте с IDF по общей
+// статистике всех сегментов, поэтому выдача совпадает с выдачей одного SearchServer.
+// Запрос берёт общую блокировку только на время копирования указателей на список сегментов
+// и memtable; сегменты он читает без блокировки, а memtable — под её собственным мьютексом,
+// поэтому поток запросов не задерживает добавление документов.
+class SegmentedSearchServer {
+public:
+    explicit SegmentedSearchServer(std::string_view stop_words_text, size_t memtable_capacity = DEFAULT_MEMTABLE_CAPACITY,
+                                   size_t max_segment_count = DEFAULT_MAX_SEGMENT_COUNT);
+    ~SegmentedSearchServer();
+
+    SegmentedSearchServer(const SegmentedSearchServer&) = delete;
+    SegmentedSearchServer& operator=(const SegmentedSearchServer&) = delete;
+
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+    void RemoveDocument(int document_id);
+
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate,
+                                           const TopKOptions& options = {}) const;
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status) const;
+    std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
+
+    // Слова копируются: сегмент, в котором лежит документ, может быть удалён слиянием сразу после возврата.
+    std::tuple<std::vector<std::string>, DocumentStatus> MatchDocument(std::string_view raw_query, int document_id) const;
+
+    int GetDocumentCount() const;
+    // Число неизменяемых сегментов, не считая memtable.
+    size_t GetSegmentCount() const;
+
+    // Выполняет все слияния, которые назначил бы фоновый поток, не дожидаясь его.
+    void Compact();
+
+private:
+    static constexpr size_t SEGMENT_MERGE_FACTOR = 4;
+
+    struct SegmentDeletions {
+        std::unordered_set<int> ids;
+        // Документные частоты слов удалённых документов, вычитаются из общей статистики.
+        std::map<std::string, int, std::less<>> document_freqs;
+        int64_t word_count = 0;
+    };
+
+    struct Segment {
+        std::shared_ptr<const SearchServer> server;
+        // Удаление заменяет набор изменённой копией, поэтому запрос читает его без блокировки.
+        std::shared_ptr<const SegmentDeletions> deletions;
+    };
+
+    using SegmentMap = std::map<int, Segment>;
+
+    struct Memtable {
+        explicit Memtable(std::string_view stop_words_text)
+            : server(stop_words_text) {
+        }
+
+        std::mutex mutex;
+        SearchServer server;
+    };
+
+    // Статистика слов запроса по сегментам, без memtable.
+    static CorpusStatistics GetSegmentStatistics(const SegmentMap& segments, std::string_view raw_query);
+    // Сегменты для следующего слияния; пусто, если сливать нечего. Вызывается под блокировкой.
+    std::vector<int> SelectSegmentsToMerge() const;
+    void FlushMemtable();
+    bool CompactSegments();
+    void RunCompaction();
+
+    const std::string stop_words_text_;
+    const size_t memtable_capacity_;
+    const size_t max_segment_count_;
+    // Используется только для разбора документов вне блокировки.
+    const SearchServer tokenizer_;
+
+    // Защищает указатели ниже, но не сами сегменты и memtable. Захват mutex_ memtable
+    // под mutex_ допустим, обратный порядок — нет.
+    mutable std::mutex mutex_;
+    std::shared_ptr<Memtable> memtable_;
+    int memtable_segment_id_ = 0;
+    int next_segment_id_ = 1;
+    // Заменяется изменённой копией при каждом изменении набора сегментов.
+    std::shared_ptr<const SegmentMap> segments_;
+    std::unordered_map<int, int> document_segments_;
+
+    std::mutex compaction_mutex_;
+    std::condition_variable compaction_condition_;
+    bool stopping_ = false;
+    std::thread compaction_thread_;
+};
+
+template <typename DocumentPredicate>
+std::vector<Document> SegmentedSearchServer::FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate,
+                                                              const TopKOptions& options) const {
+    std::shared_ptr<Memtable> memtable;
+    std::shared_ptr<const SegmentMap> segments;
+    {
+        std::lock_guard lock(mutex_);
+        memtable = memtable_;
+        segments = segments_;
+    }
+    CorpusStatistics statistics = GetSegmentStatistics(*segments, raw_query);
+
+    TopDocumentsCollector collector(options.count, options.after);
+    {
+        // Статистика memtable и поиск по ней под одним захватом, чтобы IDF соответствовала её содержимому.
+        std::lock_guard memtable_lock(memtable->mutex);
+        statistics.Merge(memtable->server.GetCorpusStatistics(raw_query));
+        collector.Merge(memtable->server.FindTopDocuments(std::execution::seq, raw_query, document_predicate, options, statistics));
+    }
+    for (const auto& [segment_id, segment] : *segments) {
+        const auto& deleted_ids = segment.deletions->ids;
+        if (deleted_ids.empty()) {
+            // Без обёртки сегмент может применить быстрый путь для DocumentStatusSet.
+            collector.Merge(segment.server->FindTopDocuments(std::execution::seq, raw_query, document_predicate, options, statistics));
+            continue;
+        }
+        const auto alive_predicate = [&deleted_ids, &document_predicate](int document_id, DocumentStatus status, int rating) {
+            return deleted_ids.count(document_id) == 0 && document_predicate(document_id, status, rating);
+        };
+        collector.Merge(segment.server->FindTopDocuments(std::execution::seq, raw_query, alive_predicate, options, statistics));
+    }
+    return collector.Extract();
+}
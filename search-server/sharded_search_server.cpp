@@ -0,0 +1,193 @@
+#include "sharded_search_server.h"
+
+#include <exception>
+#include <queue>
+#include <stdexcept>
+#include <utility>
+
+using namespace std;
+
+namespace {
+
+// Ответ читается у каждого шарда, даже если предыдущий бросил исключение, иначе
+// непрочитанный ответ достался бы следующему запросу. Бросается первая ошибка.
+template <typename Result, typename Receive>
+vector<Result> GatherReplies(const vector<unique_ptr<SearchShard>>& shards, Receive receive) {
+    vector<Result> results;
+    results.reserve(shards.size());
+    exception_ptr error;
+    for (const auto& shard : shards) {
+        try {
+            results.push_back(receive(*shard));
+        } catch (...) {
+            if (!error) {
+                error = current_exception();
+            }
+        }
+    }
+    if (error) {
+        rethrow_exception(error);
+    }
+    return results;
+}
+
+// Слияние упорядоченных выдач шардов: в куче по одному текущему документу от каждого шарда.
+vector<Document> MergeTopDocuments(const vector<vector<Document>>& shard_documents, size_t count) {
+    using Cursor = pair<size_t, size_t>;
+    const auto worse = [&shard_documents](const Cursor& lhs, const Cursor& rhs) {
+        return CompareDocuments(shard_documents[rhs.first][rhs.second], shard_documents[lhs.first][lhs.second]);
+    };
+    priority_queue<Cursor, vector<Cursor>, decltype(worse)> heads(worse);
+    for (size_t shard = 0; shard < shard_documents.size(); ++shard) {
+        if (!shard_documents[shard].empty()) {
+            heads.emplace(shard, 0);
+        }
+    }
+    vector<Document> documents;
+    while (documents.size() < count && !heads.empty()) {
+        const auto [shard, position] = heads.top();
+        heads.pop();
+        documents.push_back(shard_documents[shard][position]);
+        if (position + 1 < shard_documents[shard].size()) {
+            heads.emplace(shard, position + 1);
+        }
+    }
+    return documents;
+}
+
+}  // namespace
+
+ShardedSearchServer::ShardedSearchServer(string_view stop_words_text, size_t shard_count, ShardPlacement placement)
+        : tokenizer_(stop_words_text) {
+    if (shard_count == 0) {
+        throw invalid_argument("shard count must be positive"s);
+    }
+    shards_.reserve(shard_count);
+    for (size_t i = 0; i < shard_count; ++i) {
+        if (placement == ShardPlacement::SEPARATE_PROCESS) {
+            shards_.push_back(make_unique<ProcessShard>(stop_words_text));
+        } else {
+            shards_.push_back(make_unique<LocalShard>(stop_words_text));
+        }
+    }
+}
+
+ShardedSearchServer::ShardedSearchServer(string_view stop_words_text, vector<unique_ptr<SearchShard>> shards)
+        : tokenizer_(stop_words_text)
+        , shards_(move(shards)) {
+    if (shards_.empty()) {
+        throw invalid_argument("shard count must be positive"s);
+    }
+}
+
+void ShardedSearchServer::AddDocument(int document_id, string_view document, DocumentStatus status, const vector<int>& ratings) {
+    AddDocuments({RawDocument{document_id, document, status, ratings}});
+}
+
+void ShardedSearchServer::AddDocuments(const vector<RawDocument>& documents) {
+    set<int> batch_ids;
+    for (const RawDocument& document : documents) {
+        if (document_ids_.count(document.id) || !batch_ids.insert(document.id).second) {
+            throw invalid_argument("attempt to add a document with the id of a previously added document"s);
+        }
+        // Шард в другом процессе получает документ командой протокола, где текст не может быть пустым.
+        if (document.text.find_first_not_of(' ') == string_view::npos) {
+            throw invalid_argument("Document text cannot be empty"s);
+        }
+        tokenizer_.PrepareDocument(document.id, document.text, document.status, document.ratings);
+    }
+
+    vector<vector<RawDocument>> shard_documents(shards_.size());
+    for (const RawDocument& document : documents) {
+        shard_documents[GetShardIndex(document.id)].push_back(document);
+    }
+    size_t shard = 0;
+    try {
+        for (; shard < shards_.size(); ++shard) {
+            if (!shard_documents[shard].empty()) {
+                shards_[shard]->AddDocuments(shard_documents[shard]);
+            }
+        }
+    } catch (...) {
+        // Упавший шард мог принять часть своих документов, поэтому откатывается и он.
+        for (size_t added = 0; added <= shard; ++added) {
+            for (const RawDocument& document : shard_documents[added]) {
+                try {
+                    shards_[added]->RemoveDocument(document.id);
+                } catch (...) {
+                    document_ids_.insert(document.id);
+                }
+            }
+        }
+        throw;
+    }
+    document_ids_.merge(batch_ids);
+}
+
+void ShardedSearchServer::RemoveDocument(int document_id) {
+    if (document_ids_.erase(document_id) == 0) {
+        return;
+    }
+    shards_[GetShardIndex(document_id)]->RemoveDocument(document_id);
+}
+
+vector<Document> ShardedSearchServer::FindTopDocuments(string_view raw_query, DocumentStatusSet statuses,
+                                                       const TopKOptions& options) {
+    if (options.after || options.deadline) {
+        throw invalid_argument("ShardedSearchServer does not support TopKOptions::after and deadline"s);
+    }
+    const CorpusStatistics statistics = GetCorpusStatistics(raw_query);
+    if (statuses.IsEmpty()) {
+        return {};
+    }
+    for (const auto& shard : shards_) {
+        shard->SendFindRequest(raw_query, statuses, options, statistics);
+    }
+    const vector<vector<Document>> shard_documents = GatherReplies<vector<Document>>(shards_, [](SearchShard& shard) {
+        return shard.ReceiveDocuments();
+    });
+    return MergeTopDocuments(shard_documents, options.count);
+}
+
+vector<Document> ShardedSearchServer::FindTopDocuments(string_view raw_query, DocumentStatus status) {
+    return FindTopDocuments(raw_query, DocumentStatusSet(status));
+}
+
+vector<Document> ShardedSearchServer::FindTopDocuments(string_view raw_query) {
+    return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
+}
+
+tuple<vector<string>, DocumentStatus> ShardedSearchServer::MatchDocument(string_view raw_query, int document_id) {
+    if (document_ids_.count(document_id) == 0) {
+        throw out_of_range("document index is out of range"s);
+    }
+    return shards_[GetShardIndex(document_id)]->MatchDocument(raw_query, document_id);
+}
+
+CorpusStatistics ShardedSearchServer::GetCorpusStatistics(string_view raw_query) {
+    for (const auto& shard : shards_) {
+        shard->SendStatisticsRequest(raw_query);
+    }
+    const vector<CorpusStatistics> shard_statistics = GatherReplies<CorpusStatistics>(shards_, [](SearchShard& shard) {
+        return shard.ReceiveStatistics();
+    });
+    CorpusStatistics statistics;
+    for (const CorpusStatistics& shard : shard_statistics) {
+        statistics.Merge(shard);
+    }
+    return statistics;
+}
+
+int ShardedSearchServer::GetDocumentCount() const {
+    return static_cast<int>(document_ids_.size());
+}
+
+size_t ShardedSearchServer::GetShardCount() const {
+    return shards_.size();
+}
+
+// Мультипликативный хеш: подряд идущие id расходятся по разным шардам одинаково на всех платформах.
+size_t ShardedSearchServer::GetShardIndex(int document_id) const {
+    const uint64_t hash = static_cast<uint64_t>(static_cast<uint32_t>(document_id)) * 0x9E3779B97F4A7C15ull;
+    return static_cast<size_t>((hash >> 32) % shards_.size());
+}
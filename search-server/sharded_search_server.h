@@ -0,0 +1,56 @@
+#pragma once
+
+#include "search_server.h"
+#include "search_shard.h"
+
+#include <memory>
+#include <set>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+enum class ShardPlacement {
+    IN_PROCESS,
+    SEPARATE_PROCESS,
+};
+
+// Горизонтально разбитый индекс: документ хранится в шарде, выбранном по хешу id.
+// Запрос выполняется в два круга: сначала шарды присылают статистику слов запроса, затем ищут
+// с IDF по общей статистике и присылают свои лучшие документы, которые сливаются в общую выдачу.
+// Выдача совпадает с выдачей одного SearchServer по всем документам. Не потокобезопасен.
+class ShardedSearchServer {
+public:
+    ShardedSearchServer(std::string_view stop_words_text, size_t shard_count,
+                        ShardPlacement placement = ShardPlacement::IN_PROCESS);
+    // Пустые шарды, созданные вызывающим, с теми же стоп-словами.
+    ShardedSearchServer(std::string_view stop_words_text, std::vector<std::unique_ptr<SearchShard>> shards);
+
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+    // Документы разбираются и проверяются до отправки шардам. Если шард не смог принять свою
+    // часть пакета, уже отправленные документы пакета удаляются из шардов и исключение
+    // пробрасывается. Id документа, который не удалось удалить, остаётся занятым, чтобы
+    // повтор пакета не создал дубликат.
+    void AddDocuments(const std::vector<RawDocument>& documents);
+    void RemoveDocument(int document_id);
+
+    // Отбор только по статусам: произвольный предикат нельзя передать шарду в другом процессе.
+    // TopKOptions::after и deadline не поддерживаются.
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatusSet statuses,
+                                           const TopKOptions& options = {});
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status);
+    std::vector<Document> FindTopDocuments(std::string_view raw_query);
+
+    std::tuple<std::vector<std::string>, DocumentStatus> MatchDocument(std::string_view raw_query, int document_id);
+
+    CorpusStatistics GetCorpusStatistics(std::string_view raw_query);
+    int GetDocumentCount() const;
+    size_t GetShardCount() const;
+    size_t GetShardIndex(int document_id) const;
+
+private:
+    // Используется только для разбора документов до отправки шардам.
+    const SearchServer tokenizer_;
+    std::vector<std::unique_ptr<SearchShard>> shards_;
+    std::set<int> document_ids_;
+};
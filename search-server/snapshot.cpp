@@ -0,0 +1,171 @@
+#include "snapshot.h"
+
+#include <filesystem>
+#include <system_error>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+uint64_t ComputeChecksum(const char* data, size_t size, uint64_t hash) {
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+MappedFile::MappedFile(const string& path) {
+#ifndef _WIN32
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw runtime_error("cannot open snapshot "s + path);
+    }
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0) {
+        close(fd);
+        throw runtime_error("cannot stat snapshot "s + path);
+    }
+    size_ = static_cast<size_t>(file_stat.st_size);
+    if (size_ > 0) {
+        void* mapping = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping == MAP_FAILED) {
+            close(fd);
+            throw runtime_error("cannot map snapshot "s + path);
+        }
+        data_ = static_cast<const char*>(mapping);
+    }
+    close(fd);
+#else
+    ifstream input(path, ios::binary);
+    if (!input) {
+        throw runtime_error("cannot open snapshot "s + path);
+    }
+    buffer_.assign(istreambuf_iterator<char>(input), istreambuf_iterator<char>());
+    data_ = buffer_.data();
+    size_ = buffer_.size();
+#endif
+}
+
+MappedFile::~MappedFile() {
+#ifndef _WIN32
+    if (data_ != nullptr) {
+        munmap(const_cast<char*>(data_), size_);
+    }
+#endif
+}
+
+const char* MappedFile::data() const {
+    return data_;
+}
+
+size_t MappedFile::size() const {
+    return size_;
+}
+
+SnapshotWriter::SnapshotWriter(const string& path)
+        : path_(path)
+        , temp_path_(path + ".tmp"s)
+        , output_(temp_path_, ios::binary | ios::trunc)
+        , checksum_(ComputeChecksum(nullptr, 0)) {
+    if (!output_) {
+        throw runtime_error("cannot create snapshot "s + temp_path_);
+    }
+    const SnapshotHeader placeholder{};
+    output_.write(reinterpret_cast<const char*>(&placeholder), sizeof(placeholder));
+}
+
+void SnapshotWriter::WriteString(string_view text) {
+    Write(static_cast<uint32_t>(text.size()));
+    WriteBytes(text.data(), text.size());
+}
+
+void SnapshotWriter::Finish() {
+    SnapshotHeader header{};
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.payload_size = payload_size_;
+    header.checksum = checksum_;
+    output_.seekp(0);
+    output_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    output_.close();
+    if (!output_) {
+        throw runtime_error("failed to write snapshot");
+    }
+#ifndef _WIN32
+    // Без fsync после сбоя питания переименование могло бы сохраниться раньше содержимого.
+    const int fd = open(temp_path_.c_str(), O_WRONLY);
+    const bool synced = fd >= 0 && fsync(fd) == 0;
+    if (fd >= 0) {
+        close(fd);
+    }
+    if (!synced) {
+        throw runtime_error("cannot flush snapshot "s + temp_path_);
+    }
+#endif
+    error_code error;
+    filesystem::rename(temp_path_, path_, error);
+    if (error) {
+        throw runtime_error("cannot replace snapshot "s + path_ + ": "s + error.message());
+    }
+    finished_ = true;
+}
+
+SnapshotWriter::~SnapshotWriter() {
+    if (!finished_) {
+        output_.close();
+        error_code error;
+        filesystem::remove(temp_path_, error);
+    }
+}
+
+void SnapshotWriter::WriteBytes(const char* data, size_t size) {
+    output_.write(data, size);
+    payload_size_ += size;
+    checksum_ = ComputeChecksum(data, size, checksum_);
+}
+
+SnapshotReader::SnapshotReader(const MappedFile& file) {
+    SnapshotHeader header;
+    if (file.size() < sizeof(header)) {
+        throw runtime_error("snapshot is truncated");
+    }
+    memcpy(&header, file.data(), sizeof(header));
+    if (memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0) {
+        throw runtime_error("file is not a search server snapshot");
+    }
+    if (header.version != SNAPSHOT_VERSION) {
+        throw runtime_error("unsupported snapshot version "s + to_string(header.version));
+    }
+    if (header.payload_size != file.size() - sizeof(header)) {
+        throw runtime_error("snapshot is truncated");
+    }
+    pos_ = file.data() + sizeof(header);
+    end_ = pos_ + header.payload_size;
+    if (ComputeChecksum(pos_, header.payload_size) != header.checksum) {
+        throw runtime_error("snapshot checksum mismatch");
+    }
+}
+
+string_view SnapshotReader::ReadString() {
+    const uint32_t size = Read<uint32_t>();
+    return {Take(size), size};
+}
+
+bool SnapshotReader::AtEnd() const {
+    return pos_ == end_;
+}
+
+const char* SnapshotReader::Take(size_t size) {
+    if (size > static_cast<size_t>(end_ - pos_)) {
+        throw runtime_error("snapshot is truncated");
+    }
+    const char* data = pos_;
+    pos_ += size;
+    return data;
+}
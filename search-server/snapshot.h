@@ -0,0 +1,126 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+// Формат снимка: заголовок SnapshotHeader, за ним полезная нагрузка. Числа пишутся
+// в порядке байт машины, поэтому снимок переносим только между одинаковыми платформами.
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t payload_size;
+    uint64_t checksum;
+};
+
+inline constexpr char SNAPSHOT_MAGIC[8] = {'S', 'R', 'C', 'H', 'S', 'N', 'A', 'P'};
+inline constexpr uint32_t SNAPSHOT_VERSION = 2;
+
+// FNV-1a над полезной нагрузкой; можно считать по частям, передавая предыдущее значение.
+uint64_t ComputeChecksum(const char* data, size_t size, uint64_t hash = 14695981039346656037ull);
+
+// Файл, отображённый в память только для чтения. Где mmap недоступен, файл читается целиком.
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path);
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile();
+
+    const char* data() const;
+    size_t size() const;
+
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+    std::vector<char> buffer_;
+};
+
+// Пишет снимок во временный файл рядом с path и переименовывает его в path только в Finish,
+// поэтому прерванная запись не портит прежний снимок. Без Finish временный файл удаляется.
+class SnapshotWriter {
+public:
+    explicit SnapshotWriter(const std::string& path);
+    SnapshotWriter(const SnapshotWriter&) = delete;
+    SnapshotWriter& operator=(const SnapshotWriter&) = delete;
+    ~SnapshotWriter();
+
+    template <typename T>
+    void Write(T value);
+    template <typename T>
+    void WriteArray(const std::vector<T>& values);
+    void WriteString(std::string_view text);
+
+    // Дописывает заголовок с размером и контрольной суммой, сбрасывает файл на диск
+    // и атомарно заменяет им path.
+    void Finish();
+
+private:
+    void WriteBytes(const char* data, size_t size);
+
+    std::string path_;
+    std::string temp_path_;
+    bool finished_ = false;
+    std::ofstream output_;
+    uint64_t payload_size_ = 0;
+    uint64_t checksum_;
+};
+
+// Читает полезную нагрузку из отображённого файла, проверив заголовок и контрольную сумму.
+class SnapshotReader {
+public:
+    explicit SnapshotReader(const MappedFile& file);
+
+    template <typename T>
+    T Read();
+    template <typename T>
+    void ReadArray(std::vector<T>& values, size_t count);
+    std::string_view ReadString();
+
+    bool AtEnd() const;
+
+private:
+    const char* Take(size_t size);
+
+    const char* pos_;
+    const char* end_;
+};
+
+template <typename T>
+void SnapshotWriter::Write(T value) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    WriteBytes(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+void SnapshotWriter::WriteArray(const std::vector<T>& values) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    WriteBytes(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+}
+
+template <typename T>
+T SnapshotReader::Read() {
+    static_assert(std::is_trivially_copyable_v<T>);
+    T value;
+    std::memcpy(&value, Take(sizeof(T)), sizeof(T));
+    return value;
+}
+
+template <typename T>
+void SnapshotReader::ReadArray(std::vector<T>& values, size_t count) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    if (count > static_cast<size_t>(end_ - pos_) / sizeof(T)) {
+        throw std::runtime_error("snapshot is truncated");
+    }
+    values.resize(count);
+    if (count > 0) {
+        std::memcpy(values.data(), Take(count * sizeof(T)), count * sizeof(T));
+    }
+}
@@ -0,0 +1,351 @@
+#include "stream_protocol.h"
+
+#include <cerrno>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+
+#ifndef _WIN32
+#include <poll.h>
+#include <unistd.h>
+#else
+#include <io.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+const size_t STREAM_BUFFER_SIZE = 1 << 20;
+
+string_view NextToken(string_view& text) {
+    const size_t begin = text.find_first_not_of(' ');
+    if (begin == string_view::npos) {
+        text = {};
+        return {};
+    }
+    text.remove_prefix(begin);
+    const size_t end = min(text.find(' '), text.size());
+    const string_view token = text.substr(0, end);
+    text.remove_prefix(end);
+    return token;
+}
+
+int ParseInt(string_view token) {
+    int value = 0;
+    const auto [end, error] = from_chars(token.data(), token.data() + token.size(), value);
+    if (token.empty() || error != errc() || end != token.data() + token.size()) {
+        throw invalid_argument("Invalid number: " + string(token));
+    }
+    return value;
+}
+
+int64_t ParseInt64(string_view token) {
+    int64_t value = 0;
+    const auto [end, error] = from_chars(token.data(), token.data() + token.size(), value);
+    if (token.empty() || error != errc() || end != token.data() + token.size()) {
+        throw invalid_argument("Invalid number: " + string(token));
+    }
+    return value;
+}
+
+void AppendInt(string& output, int value) {
+    char buffer[16];
+    const auto result = to_chars(begin(buffer), end(buffer), value);
+    output.append(buffer, result.ptr);
+}
+
+void AppendDouble(string& output, double value, const char* format = "%g") {
+    char buffer[32];
+    const int size = snprintf(buffer, sizeof(buffer), format, value);
+    output.append(buffer, size);
+}
+
+DocumentStatusSet ParseStatusSet(string_view statuses) {
+    if (statuses == "ALL") {
+        return DocumentStatusSet::All();
+    }
+    DocumentStatusSet result;
+    while (!statuses.empty()) {
+        const size_t comma = min(statuses.find(','), statuses.size());
+        result.Add(ParseDocumentStatus(statuses.substr(0, comma)));
+        statuses.remove_prefix(min(comma + 1, statuses.size()));
+    }
+    return result;
+}
+
+TopKMode ParseTopKMode(string_view name) {
+    if (name == "EXHAUSTIVE") return TopKMode::EXHAUSTIVE;
+    if (name == "WAND") return TopKMode::WAND;
+    throw invalid_argument("Invalid top-k mode: " + string(name));
+}
+
+QueryMatch ParseQueryMatch(string_view name) {
+    if (name == "ANY") return QueryMatch::ANY;
+    if (name == "ALL") return QueryMatch::ALL;
+    throw invalid_argument("Invalid query match: " + string(name));
+}
+
+RankingModel ParseRankingModel(string_view name) {
+    if (name == "TF_IDF") return RankingModel::TF_IDF;
+    if (name == "BM25") return RankingModel::BM25;
+    throw invalid_argument("Invalid ranking model: " + string(name));
+}
+
+void AppendDocuments(string& output, const vector<Document>& documents, const char* relevance_format) {
+    output += "ok ";
+    AppendInt(output, static_cast<int>(documents.size()));
+    for (const Document& document : documents) {
+        output += ' ';
+        AppendInt(output, document.id);
+        output += ' ';
+        AppendDouble(output, document.relevance, relevance_format);
+        output += ' ';
+        AppendInt(output, document.rating);
+    }
+    output += '\n';
+}
+
+void AppendError(string& output, const char* message) {
+    output += "error ";
+    // Сообщение не должно разорвать ответ на несколько строк.
+    for (const char* c = message; *c != '\0'; ++c) {
+        output += *c == '\n' ? ' ' : *c;
+    }
+    output += '\n';
+}
+
+void ReadSome(int fd, char* data, size_t size, size_t& read_size) {
+    for (;;) {
+#ifndef _WIN32
+        const auto result = read(fd, data, size);
+#else
+        const auto result = _read(fd, data, static_cast<unsigned>(size));
+#endif
+        if (result >= 0) {
+            read_size = static_cast<size_t>(result);
+            return;
+        }
+        if (errno != EINTR) {
+            throw system_error(errno, generic_category(), "cannot read command stream");
+        }
+    }
+}
+
+// Есть ли во входе данные, которые можно прочитать без ожидания.
+bool HasReadyInput(int fd) {
+#ifndef _WIN32
+    pollfd input{fd, POLLIN, 0};
+    return poll(&input, 1, 0) > 0;
+#else
+    return false;
+#endif
+}
+
+void WriteAll(int fd, const string& data) {
+    size_t written = 0;
+    while (written < data.size()) {
+#ifndef _WIN32
+        const auto result = write(fd, data.data() + written, data.size() - written);
+#else
+        const auto result = _write(fd, data.data() + written, static_cast<unsigned>(data.size() - written));
+#endif
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw system_error(errno, generic_category(), "cannot write response stream");
+        }
+        written += static_cast<size_t>(result);
+    }
+}
+
+}  // namespace
+
+StreamProtocol::StreamProtocol(SearchServer& search_server)
+    : search_server_(search_server) {
+}
+
+size_t StreamProtocol::Process(string_view input, string& output) {
+    size_t consumed = 0;
+    for (size_t end = input.find('\n'); end != string_view::npos; end = input.find('\n', consumed)) {
+        string_view line = input.substr(consumed, end - consumed);
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        ExecuteCommand(line, output);
+        consumed = end + 1;
+    }
+    // Тексты накопленных add ссылаются на input, который вызывающий может переиспользовать.
+    FlushAdds(output);
+    return consumed;
+}
+
+void StreamProtocol::ExecuteCommand(string_view line, string& output) {
+    const string_view command = NextToken(line);
+    if (command.empty()) {
+        return;
+    }
+    if (command != "add") {
+        FlushAdds(output);
+    }
+    try {
+        if (command == "add") {
+            QueueAdd(line);
+        } else if (command == "find") {
+            const DocumentStatusSet allowed = ParseStatusSet(NextToken(line));
+            // WAND даёт ту же выдачу, что и полный перебор, но не обходит длинные списки целиком.
+            TopKOptions options;
+            options.mode = TopKMode::WAND;
+            AppendDocuments(output, search_server_.FindTopDocuments(execution::seq, line, allowed, options), "%g");
+        } else if (command == "stats") {
+            const CorpusStatistics statistics = search_server_.GetCorpusStatistics(line);
+            output += "ok ";
+            AppendInt(output, statistics.document_count);
+            output += ' ';
+            output += to_string(statistics.word_count);
+            output += ' ';
+            AppendInt(output, static_cast<int>(statistics.document_freqs.size()));
+            for (const auto& [word, document_freq] : statistics.document_freqs) {
+                output += ' ';
+                output += word;
+                output += ' ';
+                AppendInt(output, document_freq);
+            }
+            output += '\n';
+        } else if (command == "shardfind") {
+            const DocumentStatusSet allowed = ParseStatusSet(NextToken(line));
+            TopKOptions options;
+            const int count = ParseInt(NextToken(line));
+            // Отрицательное число после приведения к size_t стало бы огромным размером выдачи.
+            if (count < 0) {
+                throw invalid_argument("Invalid shardfind command format: negative document count");
+            }
+            options.count = static_cast<size_t>(count);
+            options.mode = ParseTopKMode(NextToken(line));
+            options.match = ParseQueryMatch(NextToken(line));
+            options.ranking = ParseRankingModel(NextToken(line));
+            CorpusStatistics statistics;
+            statistics.document_count = ParseInt(NextToken(line));
+            statistics.word_count = ParseInt64(NextToken(line));
+            for (int i = ParseInt(NextToken(line)); i > 0; --i) {
+                const string_view word = NextToken(line);
+                statistics.document_freqs.emplace(word, ParseInt(NextToken(line)));
+            }
+            if (NextToken(line) != "--") {
+                throw invalid_argument("Invalid shardfind command format: missing '--'");
+            }
+            // Релевантность передаётся без потери точности, чтобы слияние выдач шардов
+            // упорядочило документы так же, как один сервер.
+            AppendDocuments(output, search_server_.FindTopDocuments(execution::seq, line, allowed, options, statistics), "%.17g");
+        } else if (command == "match") {
+            const int document_id = ParseInt(NextToken(line));
+            const auto [words, status] = search_server_.MatchDocument(line, document_id);
+            output += "ok ";
+            output += GetDocumentStatusName(status);
+            for (const string_view word : words) {
+                output += ' ';
+                output += word;
+            }
+            output += '\n';
+        } else if (command == "remove") {
+            search_server_.RemoveDocument(ParseInt(NextToken(line)));
+            output += "ok\n";
+        } else if (command == "count") {
+            output += "ok ";
+            AppendInt(output, search_server_.GetDocumentCount());
+            output += '\n';
+        } else {
+            throw invalid_argument("Unknown command: " + string(command));
+        }
+    } catch (const exception& e) {
+        // Ответы на ранее принятые add должны уйти раньше ошибки.
+        FlushAdds(output);
+        AppendError(output, e.what());
+    }
+}
+
+void StreamProtocol::QueueAdd(string_view arguments) {
+    RawDocument document;
+    document.id = ParseInt(NextToken(arguments));
+    document.status = ParseDocumentStatus(NextToken(arguments));
+    for (string_view token = NextToken(arguments); token != "--"; token = NextToken(arguments)) {
+        if (token.empty()) {
+            throw invalid_argument("Invalid add command format: missing '--'");
+        }
+        document.ratings.push_back(ParseInt(token));
+    }
+    arguments.remove_prefix(min(arguments.find_first_not_of(' '), arguments.size()));
+    if (arguments.empty()) {
+        throw invalid_argument("Document text cannot be empty");
+    }
+    document.text = arguments;
+    pending_adds_.push_back(move(document));
+}
+
+void StreamProtocol::FlushAdds(string& output) {
+    if (pending_adds_.empty()) {
+        return;
+    }
+    bool added = false;
+    if (pending_adds_.size() > 1) {
+        // AddDocuments не меняет индекс, если хотя бы один документ отвергнут;
+        // тогда пакет повторяется по одному документу, чтобы ответить на каждый отдельно.
+        try {
+            search_server_.AddDocuments(pending_adds_);
+            added = true;
+        } catch (const invalid_argument&) {
+        }
+    }
+    for (const RawDocument& document : pending_adds_) {
+        if (added) {
+            output += "ok\n";
+            continue;
+        }
+        try {
+            search_server_.AddDocument(document.id, document.text, document.status, document.ratings);
+            output += "ok\n";
+        } catch (const exception& e) {
+            AppendError(output, e.what());
+        }
+    }
+    pending_adds_.clear();
+}
+
+void ServeStream(SearchServer& search_server, int input_fd, int output_fd) {
+    StreamProtocol protocol(search_server);
+    string buffer(STREAM_BUFFER_SIZE, '\0');
+    string output;
+    size_t filled = 0;
+    for (;;) {
+        if (filled == buffer.size()) {
+            // Строка длиннее буфера.
+            buffer.resize(buffer.size() * 2);
+        }
+        size_t read_size = 0;
+        ReadSome(input_fd, buffer.data() + filled, buffer.size() - filled, read_size);
+        if (read_size == 0) {
+            if (filled > 0) {
+                buffer[filled++] = '\n';
+                protocol.Process(string_view(buffer.data(), filled), output);
+            }
+            WriteAll(output_fd, output);
+            return;
+        }
+        filled += read_size;
+        // Пока данные приходят без ожидания, блоки склеиваются: подряд идущие add попадают
+        // в один пакет AddDocuments. Клиент, ждущий ответа, получает его сразу.
+        if (filled < buffer.size() && HasReadyInput(input_fd)) {
+            continue;
+        }
+        const size_t consumed = protocol.Process(string_view(buffer.data(), filled), output);
+        memmove(buffer.data(), buffer.data() + consumed, filled - consumed);
+        filled -= consumed;
+        if (!output.empty()) {
+            WriteAll(output_fd, output);
+            output.clear();
+        }
+    }
+}
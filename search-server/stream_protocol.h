@@ -0,0 +1,44 @@
+#pragma once
+
+#include "search_server.h"
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Неинтерактивный построчный протокол. Каждая строка — одна команда, на каждую команду
+// выдаётся ровно одна строка ответа в порядке поступления, поэтому команды можно
+// отправлять пачкой, не дожидаясь ответов:
+//   add <id> <status> [<rating>...] -- <text>  ->  ok
+//   find <status>[,<status>...]|ALL <query>    ->  ok <n> <id> <relevance> <rating> ...
+//   match <id> <query>                         ->  ok <status> [<word>...]
+//   remove <id>                                ->  ok
+//   count                                      ->  ok <n>
+// Команды для ShardedSearchServer, управляющего сервером как шардом:
+//   stats <query>  ->  ok <documents> <words> <n> [<word> <document_freq>...]
+//   shardfind <statuses> <count> <EXHAUSTIVE|WAND> <ANY|ALL> <TF_IDF|BM25>
+//             <documents> <words> <n> [<word> <document_freq>...] -- <query>
+//                  ->  ответ find с релевантностью без потери точности
+// Ошибка в команде даёт строку "error <сообщение>" и не прерывает обработку потока.
+class StreamProtocol {
+public:
+    explicit StreamProtocol(SearchServer& search_server);
+
+    // Выполняет все завершённые переводом строки команды из input и дописывает ответы в output.
+    // Возвращает число обработанных байт: незавершённая последняя строка остаётся вызывающему.
+    size_t Process(std::string_view input, std::string& output);
+
+private:
+    void ExecuteCommand(std::string_view line, std::string& output);
+    // Подряд идущие add копятся и добавляются одним вызовом AddDocuments.
+    void QueueAdd(std::string_view arguments);
+    void FlushAdds(std::string& output);
+
+    SearchServer& search_server_;
+    std::vector<RawDocument> pending_adds_;
+};
+
+// Читает команды из input_fd блоками, не копируя строки, и пишет ответы в output_fd
+// одним буфером на каждый прочитанный блок. Возвращается по окончании ввода.
+void ServeStream(SearchServer& search_server, int input_fd, int output_fd);
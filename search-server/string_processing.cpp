@@ -2,21 +2,10 @@
 
 using namespace std;
 
-vector<string> SplitIntoWords(const string& text) {
-    vector<string> words;
-    string word;
-    for (const char c : text) {
-        if (c == ' ') {
-            if (!word.empty()) {
-                words.push_back(word);
-                word.clear();
-            }
-        } else {
-            word += c;
-        }
-    }
-    if (!word.empty()) {
+vector<string_view> SplitIntoWords(string_view text) {
+    vector<string_view> words;
+    ForEachWord(text, [&words](string_view word) {
         words.push_back(word);
-    }
+    });
     return words;
 }
@@ -1,18 +1,37 @@
 #pragma once
 #include <string>
+#include <string_view>
 #include <vector>
 #include <set>
 
 
-std::vector<std::string> SplitIntoWords(const std::string& text);
+// Возвращаемые представления ссылаются на символы text и живут, пока жива исходная строка.
+std::vector<std::string_view> SplitIntoWords(std::string_view text);
+
+// Вызывает function для каждого слова text, не собирая слова в контейнер.
+template <typename Function>
+void ForEachWord(std::string_view text, Function function) {
+    size_t word_begin = 0;
+    for (size_t pos = 0; pos < text.size(); ++pos) {
+        if (text[pos] == ' ') {
+            if (pos > word_begin) {
+                function(text.substr(word_begin, pos - word_begin));
+            }
+            word_begin = pos + 1;
+        }
+    }
+    if (text.size() > word_begin) {
+        function(text.substr(word_begin));
+    }
+}
 
 template <typename StringContainer>
-std::set<std::string> MakeUniqueNonEmptyStrings(const StringContainer& strings){
-std::set<std::string> non_empty_strings;
-    for (const std::string& str : strings) {
-        if (!str.empty()) {
-            non_empty_strings.insert(str);
+std::set<std::string, std::less<>> MakeUniqueNonEmptyStrings(const StringContainer& strings){
+std::set<std::string, std::less<>> non_empty_strings;
+    for (const auto& str : strings) {
+        if (!std::string_view(str).empty()) {
+            non_empty_strings.emplace(str);
         }
     }
     return non_empty_strings;
-}
\ No newline at end of file
+}
@@ -0,0 +1,130 @@
+#include "search_server.h"
+
+#include <execution>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+// Проверки не зависят от NDEBUG, поэтому тест работает и в Release-сборке.
+namespace {
+
+void Check(bool condition, string_view message) {
+    if (!condition) {
+        throw runtime_error(string(message));
+    }
+}
+
+template <typename Exception, typename Function>
+void CheckThrows(Function function, string_view message) {
+    try {
+        function();
+    } catch (const Exception&) {
+        return;
+    }
+    throw runtime_error(string(message));
+}
+
+const vector<string> TEXTS = {
+    "funny pet and nasty rat",
+    "funny pet with curly hair",
+    "big cat nasty hair",
+    "big dog cat Vladislav",
+    "big dog hamster Borya",
+    "curly cat curly tail",
+    "pet rat white tail",
+};
+
+SearchServer MakeServer(const vector<int>& ids) {
+    SearchServer server("and with"s);
+    for (const int id : ids) {
+        server.AddDocument(id, TEXTS[id], DocumentStatus::ACTUAL, {id, 1});
+    }
+    return server;
+}
+
+// Сервер после удалений должен отвечать так же, как сервер, в который удалённые документы не добавлялись.
+void CheckSameResults(const SearchServer& expected, const SearchServer& actual) {
+    Check(actual.GetDocumentCount() == expected.GetDocumentCount(), "document count matches fresh server");
+    TopKOptions wand_options;
+    wand_options.mode = TopKMode::WAND;
+    for (const string_view query : {"curly cat"sv, "big -dog"sv, "pet rat tail"sv, "nasty hair -white"sv}) {
+        for (const TopKOptions& options : {TopKOptions{}, wand_options}) {
+            const DocumentStatusSet statuses(DocumentStatus::ACTUAL);
+            const vector<Document> expected_documents = expected.FindTopDocuments(query, statuses, options);
+            const vector<Document> actual_documents = actual.FindTopDocuments(query, statuses, options);
+            Check(actual_documents.size() == expected_documents.size(), "result size matches fresh server");
+            for (size_t i = 0; i < actual_documents.size(); ++i) {
+                Check(actual_documents[i].id == expected_documents[i].id
+                          && actual_documents[i].relevance == expected_documents[i].relevance
+                          && actual_documents[i].rating == expected_documents[i].rating,
+                      "result documents match fresh server");
+            }
+        }
+    }
+}
+
+void TestRemovedDocumentDisappears() {
+    SearchServer server = MakeServer({0, 1, 2, 3, 4, 5, 6});
+    server.RemoveDocument(2);
+    server.RemoveDocument(execution::par, 5);
+    // Неизвестный id ничего не меняет.
+    server.RemoveDocument(execution::seq, 100);
+
+    Check(server.GetDocumentCount() == 5, "document count after removal");
+    Check(vector<int>(server.begin(), server.end()) == vector<int>{0, 1, 3, 4, 6}, "removed ids are not iterated");
+    Check(server.GetWordFrequencies(2).empty(), "removed document has no word frequencies");
+    Check(server.GetDocumentTermIds(5).empty(), "removed document has no term ids");
+    Check(server.GetDocumentWordCount(2) == 0, "removed document has no words");
+    CheckThrows<out_of_range>([&] { server.MatchDocument("cat", 2); }, "removed document cannot be matched");
+    for (const string_view query : {"curly cat"sv, "nasty hair"sv}) {
+        for (const Document& document : server.FindTopDocuments(query)) {
+            Check(document.id != 2 && document.id != 5, "removed documents are not found");
+        }
+    }
+
+    // Освободившийся id можно занять снова.
+    server.AddDocument(2, TEXTS[2], DocumentStatus::ACTUAL, {2, 1});
+    CheckSameResults(MakeServer({0, 1, 2, 3, 4, 6}), server);
+}
+
+void TestCompactionKeepsResults() {
+    SearchServer server = MakeServer({0, 1, 2, 3, 4, 5, 6});
+    for (const int id : {1, 3, 4}) {
+        server.RemoveDocument(id);
+    }
+    SearchServer expected = MakeServer({0, 2, 5, 6});
+    CheckSameResults(expected, server);
+    Check(server.GetDocumentId(1) == 2 && server.GetDocumentId(3) == 6, "document order skips tombstones");
+
+    server.CompactIndex();
+    CheckSameResults(expected, server);
+    Check(server.GetDocumentId(0) == 0 && server.GetDocumentId(1) == 2 && server.GetDocumentId(2) == 5
+              && server.GetDocumentId(3) == 6,
+          "document order survives compaction");
+    Check(server.GetWordFrequencies(5) == expected.GetWordFrequencies(5), "word frequencies survive compaction");
+
+    // Сжатый индекс продолжает пополняться и удалять документы.
+    server.AddDocument(1, TEXTS[1], DocumentStatus::ACTUAL, {1, 1});
+    server.RemoveDocument(0);
+    expected.AddDocument(1, TEXTS[1], DocumentStatus::ACTUAL, {1, 1});
+    expected.RemoveDocument(0);
+    CheckSameResults(expected, server);
+}
+
+}  // namespace
+
+int main() {
+    try {
+        TestRemovedDocumentDisappears();
+        TestCompactionKeepsResults();
+    } catch (const exception& e) {
+        cerr << "FAILED: " << e.what() << endl;
+        return 1;
+    }
+    cout << "OK" << endl;
+    return 0;
+}
@@ -0,0 +1,137 @@
+#include "search_server.h"
+
+#include <algorithm>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+// Проверки не зависят от NDEBUG, поэтому тест работает и в Release-сборке.
+namespace {
+
+void Check(bool condition, string_view message) {
+    if (!condition) {
+        throw runtime_error(string(message));
+    }
+}
+
+template <typename Exception, typename Function>
+void CheckThrows(Function function, string_view message) {
+    try {
+        function();
+    } catch (const Exception&) {
+        return;
+    }
+    throw runtime_error(string(message));
+}
+
+vector<int> GetIds(const vector<Document>& documents) {
+    vector<int> ids;
+    for (const Document& document : documents) {
+        ids.push_back(document.id);
+    }
+    sort(ids.begin(), ids.end());
+    return ids;
+}
+
+SearchServer MakeServer() {
+    SearchServer server("and the"s);
+    server.AddDocument(1, "big white cat sleeps", DocumentStatus::ACTUAL, {1});
+    server.AddDocument(2, "white big cat", DocumentStatus::ACTUAL, {2});
+    server.AddDocument(3, "cat is big and white", DocumentStatus::ACTUAL, {3});
+    server.AddDocument(4, "the white and big cat", DocumentStatus::ACTUAL, {4});
+    server.AddDocument(5, "big dog chases white cat", DocumentStatus::BANNED, {5});
+    return server;
+}
+
+// Слова фразы должны идти подряд; стоп-слова между ними не учитываются.
+void TestPhraseQueries() {
+    const SearchServer server = MakeServer();
+    TopKOptions options;
+    options.count = 100;
+    const DocumentStatusSet all = DocumentStatusSet::All();
+
+    Check(GetIds(server.FindTopDocuments("\"big cat\"", all, options)) == vector<int>{2, 4}, "phrase requires adjacent words");
+    Check(GetIds(server.FindTopDocuments("\"white cat\"", all, options)) == vector<int>{1, 5}, "phrase matches anywhere in document");
+    Check(GetIds(server.FindTopDocuments("\"white cat\" -sleeps", all, options)) == vector<int>{5}, "minus word excludes phrase match");
+    Check(GetIds(server.FindTopDocuments("\"cat big\"", all, options)).empty(), "phrase word order matters");
+    Check(GetIds(server.FindTopDocuments("\"white big cat\" dog", all, options)) == vector<int>{2, 4}, "phrase and plus word");
+    Check(GetIds(server.FindTopDocuments("\"big unicorn\"", all, options)).empty(), "phrase with unknown word matches nothing");
+    Check(GetIds(server.FindTopDocuments("\"big\" \"white\"", all, options)) == vector<int>{1, 2, 3, 4, 5}, "one-word phrases");
+
+    const SearchServer::Query query = server.ParseQuery("\"big and cat\" dog");
+    Check(query.phrases == vector<vector<string_view>>{{"big"sv, "cat"sv}}, "stop words are dropped from phrase");
+    Check(query.plus_words == vector<string_view>{"big"sv, "cat"sv, "dog"sv}, "phrase words are plus words");
+
+    const auto [matched, status] = server.MatchDocument("\"big cat\"", 4);
+    Check(matched == vector<string_view>{"big"sv, "cat"sv} && status == DocumentStatus::ACTUAL, "phrase match returns words");
+    Check(get<0>(server.MatchDocument("\"big cat\"", 1)).empty(), "unmatched phrase returns no words");
+}
+
+void TestStrayQuotesAreRejected() {
+    const SearchServer server = MakeServer();
+    for (const string_view query : {"ca\"t"sv, "cat\""sv, "\"big cat"sv, "\"big\"cat\""sv, "\"big -cat\""sv}) {
+        CheckThrows<invalid_argument>([&] { server.FindTopDocuments(query); }, "malformed quoted query is rejected");
+        CheckThrows<invalid_argument>([&] { server.MatchDocument(query, 1); }, "malformed quoted query is rejected by match");
+    }
+    Check(server.FindTopDocuments("\"\" cat").size() == 4, "empty phrase is ignored");
+}
+
+// Пересечение списков в режиме ALL должно отобрать те же документы с той же релевантностью,
+// что и режим ANY, из выдачи которого убраны документы без какого-либо из слов.
+void TestAllMatchesFilteredAny() {
+    mt19937 generator(11);
+    geometric_distribution<int> word(0.2);
+    SearchServer server("w0"s);
+    for (int id = 0; id < 3000; ++id) {
+        string text;
+        for (int i = 0; i < 4 + id % 9; ++i) {
+            text += "w"s + to_string(word(generator)) + ' ';
+        }
+        server.AddDocument(id, text, DocumentStatus::ACTUAL, {id % 5});
+    }
+    for (const string_view query : {"w1 w2"sv, "w1 w4 w9"sv, "w2 w3 -w1"sv, "w12 w1"sv}) {
+        const vector<string_view> plus_words = server.ParseQuery(query).plus_words;
+        TopKOptions options;
+        options.count = 3000;
+        vector<Document> expected;
+        for (const Document& document : server.FindTopDocuments(query, DocumentStatusSet::All(), options)) {
+            const auto freqs = server.GetWordFrequencies(document.id);
+            if (all_of(plus_words.begin(), plus_words.end(), [&freqs](string_view plus_word) {
+                    return freqs.count(plus_word) > 0;
+                })) {
+                expected.push_back(document);
+            }
+        }
+        Check(!expected.empty(), "query matches documents with all words");
+        for (const size_t count : {5u, 3000u}) {
+            options.count = count;
+            options.match = QueryMatch::ALL;
+            const vector<Document> actual = server.FindTopDocuments(query, DocumentStatusSet::All(), options);
+            Check(actual.size() == min(count, expected.size()), "ALL result size matches filtered ANY");
+            for (size_t i = 0; i < actual.size(); ++i) {
+                Check(actual[i].id == expected[i].id && actual[i].relevance == expected[i].relevance,
+                      "ALL result matches filtered ANY");
+            }
+        }
+    }
+}
+
+}  // namespace
+
+int main() {
+    try {
+        TestPhraseQueries();
+        TestStrayQuotesAreRejected();
+        TestAllMatchesFilteredAny();
+    } catch (const exception& e) {
+        cerr << "FAILED: " << e.what() << endl;
+        return 1;
+    }
+    cout << "OK" << endl;
+    return 0;
+}
@@ -0,0 +1,139 @@
+#include "query_cache.h"
+#include "request_queue.h"
+#include "search_server.h"
+
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+// Проверки не зависят от NDEBUG, поэтому тест работает и в Release-сборке.
+namespace {
+
+void Check(bool condition, string_view message) {
+    if (!condition) {
+        throw runtime_error(string(message));
+    }
+}
+
+bool SameDocuments(const vector<Document>& lhs, const vector<Document>& rhs) {
+    if (lhs.size() != rhs.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < lhs.size(); ++i) {
+        if (lhs[i].id != rhs[i].id || lhs[i].relevance != rhs[i].relevance || lhs[i].rating != rhs[i].rating) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ContainsDocument(const vector<Document>& documents, int document_id) {
+    for (const Document& document : documents) {
+        if (document.id == document_id) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void AddDocuments(SearchServer& server) {
+    server.AddDocument(1, "funny pet and nasty rat", DocumentStatus::ACTUAL, {7, 2, 7});
+    server.AddDocument(2, "funny pet with curly hair", DocumentStatus::ACTUAL, {1, 2});
+    server.AddDocument(3, "big cat nasty hair", DocumentStatus::BANNED, {-3});
+    server.AddDocument(4, "curly cat curly tail", DocumentStatus::ACTUAL, {4, 4});
+}
+
+// Запросы, разные по записи, но одинаковые после разбора, попадают в одну запись кэша.
+void TestEquivalentQueriesShareEntry() {
+    SearchServer server("and with"s);
+    AddDocuments(server);
+    RequestQueue queue(server);
+    const QueryCache& cache = queue.GetCache();
+
+    const vector<Document> first = queue.AddFindRequest("curly cat -rat");
+    Check(cache.GetHitCount() == 0 && cache.GetMissCount() == 1, "first query misses");
+    const vector<Document> second = queue.AddFindRequest("cat and curly -rat cat");
+    Check(cache.GetHitCount() == 1 && cache.GetMissCount() == 1, "equivalent query hits");
+    Check(SameDocuments(first, second) && SameDocuments(first, server.FindTopDocuments("curly cat -rat")),
+          "cached result matches the server");
+
+    queue.AddFindRequest("curly cat -rat", DocumentStatus::BANNED);
+    Check(cache.GetMissCount() == 2, "other status filter misses");
+    queue.AddFindRequest("curly cat", DocumentStatus::ACTUAL);
+    Check(cache.GetMissCount() == 3, "query without minus word misses");
+
+    // Произвольный предикат идёт мимо кэша.
+    const vector<Document> by_predicate = queue.AddFindRequest("curly cat -rat", [](int document_id, DocumentStatus, int) {
+        return document_id == 2;
+    });
+    Check(by_predicate.size() == 1 && by_predicate[0].id == 2, "predicate query is executed");
+    Check(cache.GetHitCount() == 1 && cache.GetMissCount() == 3, "predicate query bypasses cache");
+}
+
+// Добавление и удаление документа меняют поколение индекса, и закэшированная выдача сбрасывается.
+void TestIndexChangesInvalidateCache() {
+    SearchServer server("and with"s);
+    AddDocuments(server);
+    RequestQueue queue(server);
+    const QueryCache& cache = queue.GetCache();
+
+    Check(!ContainsDocument(queue.AddFindRequest("cat"), 5), "new document is not indexed yet");
+    queue.AddFindRequest("cat");
+    Check(cache.GetHitCount() == 1, "repeated query hits");
+
+    server.AddDocument(5, "cat cat cat", DocumentStatus::ACTUAL, {10});
+    const vector<Document> after_add = queue.AddFindRequest("cat");
+    Check(cache.GetHitCount() == 1 && cache.GetMissCount() == 2, "add invalidates cache");
+    Check(ContainsDocument(after_add, 5), "result after add contains new document");
+    queue.AddFindRequest("cat");
+    Check(cache.GetHitCount() == 2, "cache refills after add");
+
+    server.RemoveDocument(5);
+    const vector<Document> after_remove = queue.AddFindRequest("cat");
+    Check(cache.GetHitCount() == 2 && cache.GetMissCount() == 3, "remove invalidates cache");
+    Check(!ContainsDocument(after_remove, 5), "result after remove lacks removed document");
+    Check(SameDocuments(after_remove, server.FindTopDocuments("cat")), "result after remove matches the server");
+
+    // Удаление неизвестного id индекс не меняет.
+    server.RemoveDocument(100);
+    queue.AddFindRequest("cat");
+    Check(cache.GetHitCount() == 3, "removing unknown id keeps cache");
+}
+
+void TestMemoryBudgetEvictsLeastRecentlyUsed() {
+    const vector<Document> documents = {Document(1, 0.5, 3)};
+    QueryCache probe(1 << 20);
+    probe.Insert("k0", documents, 0);
+    const size_t entry_size = probe.GetMemoryUsage();
+
+    QueryCache cache(3 * entry_size);
+    for (const string key : {"k0", "k1", "k2"}) {
+        cache.Insert(key, documents, 0);
+    }
+    Check(cache.Find("k0", 0) != nullptr, "entry within budget is kept");
+    cache.Insert("k3", documents, 0);
+    Check(cache.GetMemoryUsage() <= 3 * entry_size, "cache stays within budget");
+    Check(cache.Find("k1", 0) == nullptr, "least recently used entry is evicted");
+    Check(cache.Find("k0", 0) != nullptr && cache.Find("k3", 0) != nullptr, "recent entries are kept");
+
+    Check(cache.Find("k0", 1) == nullptr && cache.GetMemoryUsage() == 0, "new generation clears cache");
+}
+
+}  // namespace
+
+int main() {
+    try {
+        TestEquivalentQueriesShareEntry();
+        TestIndexChangesInvalidateCache();
+        TestMemoryBudgetEvictsLeastRecentlyUsed();
+    } catch (const exception& e) {
+        cerr << "FAILED: " << e.what() << endl;
+        return 1;
+    }
+    cout << "OK" << endl;
+    return 0;
+}
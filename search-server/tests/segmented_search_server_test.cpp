@@ -0,0 +1,113 @@
+#include "search_server.h"
+#include "segmented_search_server.h"
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// Проверки не зависят от NDEBUG, поэтому тест работает и в Release-сборке.
+namespace {
+
+void Check(bool condition, string_view message) {
+    if (!condition) {
+        throw runtime_error(string(message));
+    }
+}
+
+string MakeText(int index) {
+    return "cat dog w"s + to_string(index % 97) + " w"s + to_string(index % 13) + " w"s + to_string(index % 7);
+}
+
+void CheckSameResults(const SearchServer& expected, const SegmentedSearchServer& actual) {
+    Check(actual.GetDocumentCount() == expected.GetDocumentCount(), "document count matches single server");
+    for (const string_view query : {"cat w5 -w3"sv, "w1 w2 w3"sv, "dog -cat"sv, "\"cat dog\" w11"sv}) {
+        for (const DocumentStatus status : {DocumentStatus::ACTUAL, DocumentStatus::BANNED}) {
+            const vector<Document> expected_documents = expected.FindTopDocuments(query, status);
+            const vector<Document> actual_documents = actual.FindTopDocuments(query, status);
+            Check(actual_documents.size() == expected_documents.size(), "result size matches single server");
+            for (size_t i = 0; i < actual_documents.size(); ++i) {
+                Check(actual_documents[i].id == expected_documents[i].id
+                          && actual_documents[i].relevance == expected_documents[i].relevance
+                          && actual_documents[i].rating == expected_documents[i].rating,
+                      "result documents match single server");
+            }
+        }
+    }
+}
+
+void TestMatchesSingleServer() {
+    SearchServer expected("and in"s);
+    SegmentedSearchServer actual("and in"sv, 40, 3);
+    for (int i = 0; i < 1000; ++i) {
+        const DocumentStatus status = i % 5 == 0 ? DocumentStatus::BANNED : DocumentStatus::ACTUAL;
+        expected.AddDocument(i, MakeText(i), status, {i % 11});
+        actual.AddDocument(i, MakeText(i), status, {i % 11});
+        if (i % 4 == 1) {
+            expected.RemoveDocument(i / 2);
+            actual.RemoveDocument(i / 2);
+        }
+    }
+    CheckSameResults(expected, actual);
+    actual.Compact();
+    Check(actual.GetSegmentCount() <= 3, "compaction bounds segment count");
+    CheckSameResults(expected, actual);
+
+    const auto [words, status] = actual.MatchDocument("cat w5 fox", 999);
+    Check(status == DocumentStatus::ACTUAL && words == vector<string>{"cat", "w5"}, "match document");
+}
+
+// Запросы не держат общую блокировку на время поиска, поэтому непрерывный поток
+// запросов не должен надолго задерживать добавление документов.
+void TestIngestionDuringQueries() {
+    SegmentedSearchServer server("in"sv, 50, 2);
+    for (int i = 0; i < 2000; ++i) {
+        server.AddDocument(i, MakeText(i), DocumentStatus::ACTUAL, {i});
+    }
+    atomic<bool> done{false};
+    atomic<uint64_t> query_count{0};
+    vector<thread> readers;
+    for (int r = 0; r < 3; ++r) {
+        readers.emplace_back([&server, &done, &query_count] {
+            while (!done) {
+                server.FindTopDocuments("cat w5 -w7");
+                ++query_count;
+            }
+        });
+    }
+    const auto start = chrono::steady_clock::now();
+    for (int i = 2000; i < 2300; ++i) {
+        server.AddDocument(i, MakeText(i), DocumentStatus::ACTUAL, {i});
+        if (i % 3 == 0) {
+            server.RemoveDocument(i / 2);
+        }
+    }
+    const auto elapsed = chrono::steady_clock::now() - start;
+    done = true;
+    for (thread& reader : readers) {
+        reader.join();
+    }
+    Check(query_count > 0, "queries ran during ingestion");
+    Check(elapsed < chrono::seconds(5), "ingestion is not starved by queries");
+    Check(server.GetDocumentCount() == 2300 - 100, "all documents added during queries");
+}
+
+}  // namespace
+
+int main() {
+    try {
+        TestMatchesSingleServer();
+        TestIngestionDuringQueries();
+    } catch (const exception& e) {
+        cerr << "FAILED: " << e.what() << endl;
+        return 1;
+    }
+    cout << "OK" << endl;
+    return 0;
+}
@@ -0,0 +1,221 @@
+#include "search_server.h"
+#include "sharded_search_server.h"
+#include "stream_protocol.h"
+
+#include <algorithm>
+#include <execution>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/wait.h>
+#endif
+
+using namespace std;
+
+// Проверки не зависят от NDEBUG, поэтому тест работает и в Release-сборке.
+namespace {
+
+void Check(bool condition, string_view message) {
+    if (!condition) {
+        throw runtime_error(string(message));
+    }
+}
+
+template <typename Exception, typename Function>
+void CheckThrows(Function function, string_view message) {
+    try {
+        function();
+    } catch (const Exception&) {
+        return;
+    }
+    throw runtime_error(string(message));
+}
+
+const vector<string> TEXTS = {
+    "funny pet and nasty rat",
+    "funny pet with curly hair",
+    "big cat nasty hair",
+    "big dog cat Vladislav",
+    "big dog hamster Borya",
+    "curly cat curly tail",
+    "pet rat white tail",
+};
+
+// Выдача шардированного сервера должна совпадать с выдачей одного сервера по тем же документам.
+void TestShardedMatchesSingleServer(ShardPlacement placement, size_t shard_count) {
+    ShardedSearchServer sharded("and in at"s, shard_count, placement);
+    SearchServer single("and in at"s);
+    for (int i = 0; i < static_cast<int>(TEXTS.size()); ++i) {
+        sharded.AddDocument(i * 3, TEXTS[i], static_cast<DocumentStatus>(i % 2), {i, 2});
+        single.AddDocument(i * 3, TEXTS[i], static_cast<DocumentStatus>(i % 2), {i, 2});
+    }
+    Check(sharded.GetDocumentCount() == static_cast<int>(TEXTS.size()), "document count after add");
+
+    CheckThrows<invalid_argument>([&] { sharded.AddDocument(3, "duplicate id", DocumentStatus::ACTUAL, {}); },
+                                  "duplicate id is rejected");
+    const vector<RawDocument> invalid_batch = {
+        {100, "good text", DocumentStatus::ACTUAL, {1}},
+        {101, "bad\x01text", DocumentStatus::ACTUAL, {1}},
+    };
+    CheckThrows<invalid_argument>([&] { sharded.AddDocuments(invalid_batch); },
+                                  "batch with invalid text is rejected");
+    Check(sharded.GetDocumentCount() == static_cast<int>(TEXTS.size()), "failed batch leaves shards unchanged");
+    CheckThrows<invalid_argument>([&] { sharded.FindTopDocuments("cat --dog"); }, "invalid query is rejected");
+    CheckThrows<invalid_argument>([&] { sharded.FindTopDocuments("cat\ndog"); }, "query with line break is rejected");
+
+    for (const string_view query : {"curly nasty cat"sv, "big -dog"sv, "pet rat tail"sv, "\"big dog\""sv, ""sv}) {
+        for (const DocumentStatusSet statuses : {DocumentStatusSet(DocumentStatus::ACTUAL), DocumentStatusSet::All(),
+                                                 DocumentStatusSet()}) {
+            for (const RankingModel ranking : {RankingModel::TF_IDF, RankingModel::BM25}) {
+                TopKOptions options;
+                options.ranking = ranking;
+                const vector<Document> expected = single.FindTopDocuments(execution::seq, query, statuses, options);
+                const vector<Document> actual = sharded.FindTopDocuments(query, statuses, options);
+                Check(actual.size() == expected.size(), "result size matches single server");
+                for (size_t i = 0; i < actual.size(); ++i) {
+                    Check(actual[i].id == expected[i].id && actual[i].relevance == expected[i].relevance
+                              && actual[i].rating == expected[i].rating,
+                          "result documents match single server");
+                }
+            }
+        }
+    }
+
+    const auto [words, status] = sharded.MatchDocument("curly cat -hair", 15);
+    Check(words == vector<string>{"cat", "curly"} && status == DocumentStatus::IRRELEVANT, "match document");
+    CheckThrows<out_of_range>([&] { sharded.MatchDocument("cat", 4); }, "match of unknown id is rejected");
+
+    sharded.RemoveDocument(15);
+    sharded.RemoveDocument(999);
+    Check(sharded.GetDocumentCount() == static_cast<int>(TEXTS.size()) - 1, "document count after remove");
+    Check(sharded.FindTopDocuments("curly tail", DocumentStatusSet::All()).size() == 2, "removed document is not found");
+}
+
+// Локальный шард, который по команде теряет связь: принимает половину пакета и бросает
+// исключение, как ProcessShard с оборвавшимся сокетом.
+class FailingShard : public LocalShard {
+public:
+    using LocalShard::LocalShard;
+
+    bool fail_adds = false;
+    bool fail_removes = false;
+
+    void AddDocuments(const vector<RawDocument>& documents) override {
+        if (!fail_adds) {
+            LocalShard::AddDocuments(documents);
+            return;
+        }
+        LocalShard::AddDocuments(vector<RawDocument>(documents.begin(), documents.begin() + documents.size() / 2));
+        throw runtime_error("shard connection lost");
+    }
+
+    void RemoveDocument(int document_id) override {
+        if (fail_removes) {
+            throw runtime_error("shard connection lost");
+        }
+        LocalShard::RemoveDocument(document_id);
+    }
+};
+
+void TestFailedBatchIsRolledBack() {
+    vector<unique_ptr<SearchShard>> shards;
+    vector<FailingShard*> failing_shards;
+    for (int i = 0; i < 3; ++i) {
+        auto shard = make_unique<FailingShard>("and in at"sv);
+        failing_shards.push_back(shard.get());
+        shards.push_back(move(shard));
+    }
+    ShardedSearchServer sharded("and in at"sv, move(shards));
+    SearchServer single("and in at"s);
+    vector<RawDocument> batch;
+    for (int i = 0; i < static_cast<int>(TEXTS.size()); ++i) {
+        batch.push_back({i * 3, TEXTS[i], DocumentStatus::ACTUAL, {i}});
+        single.AddDocument(i * 3, TEXTS[i], DocumentStatus::ACTUAL, {i});
+    }
+    // Последний шард с документами пакета падает после того, как остальные свои приняли.
+    size_t last_shard = 0;
+    for (const RawDocument& document : batch) {
+        last_shard = max(last_shard, sharded.GetShardIndex(document.id));
+    }
+    failing_shards[last_shard]->fail_adds = true;
+    CheckThrows<runtime_error>([&] { sharded.AddDocuments(batch); }, "failed shard error is propagated");
+    Check(sharded.GetDocumentCount() == 0, "failed batch is not recorded");
+    Check(sharded.FindTopDocuments("cat pet rat big", DocumentStatusSet::All()).empty(), "failed batch is removed from shards");
+
+    failing_shards[last_shard]->fail_adds = false;
+    sharded.AddDocuments(batch);
+    Check(sharded.GetDocumentCount() == static_cast<int>(TEXTS.size()), "retried batch is added");
+    const vector<Document> expected = single.FindTopDocuments("curly cat pet", DocumentStatusSet::All());
+    const vector<Document> actual = sharded.FindTopDocuments("curly cat pet", DocumentStatusSet::All());
+    Check(actual.size() == expected.size(), "retried batch has no duplicates");
+    for (size_t i = 0; i < actual.size(); ++i) {
+        Check(actual[i].id == expected[i].id && actual[i].relevance == expected[i].relevance,
+              "retried batch matches single server");
+    }
+
+    // Документ, который не удалось откатить, держит свой id.
+    const vector<RawDocument> second_batch = {
+        {100, "lonely fox", DocumentStatus::ACTUAL, {1}},
+        {101, "lonely owl", DocumentStatus::ACTUAL, {1}},
+        {102, "lonely elk", DocumentStatus::ACTUAL, {1}},
+    };
+    for (FailingShard* shard : failing_shards) {
+        shard->fail_adds = true;
+        shard->fail_removes = true;
+    }
+    CheckThrows<runtime_error>([&] { sharded.AddDocuments(second_batch); }, "second failed batch error is propagated");
+    for (FailingShard* shard : failing_shards) {
+        shard->fail_adds = false;
+        shard->fail_removes = false;
+    }
+    CheckThrows<invalid_argument>([&] { sharded.AddDocuments(second_batch); },
+                                  "ids left in shards after a failed rollback stay reserved");
+}
+
+void TestShardFindRejectsNegativeCount() {
+    SearchServer search_server("and"s);
+    StreamProtocol protocol(search_server);
+    string output;
+    protocol.Process("add 1 ACTUAL 5 -- big cat\n"
+                     "shardfind ACTUAL -1 EXHAUSTIVE ANY TF_IDF 1 2 1 cat 1 -- cat\n"
+                     "shardfind ACTUAL 1 EXHAUSTIVE ANY TF_IDF 1 2 1 cat 1 -- cat\n",
+                     output);
+    const size_t first_end = output.find('\n');
+    const size_t second_end = output.find('\n', first_end + 1);
+    Check(output.substr(0, first_end) == "ok", "add reply");
+    Check(output.compare(first_end + 1, 6, "error ") == 0, "negative shardfind count is rejected");
+    Check(output.compare(second_end + 1, 5, "ok 1 ") == 0, "stream continues after rejected command");
+}
+
+}  // namespace
+
+int main() {
+    try {
+        for (const ShardPlacement placement : {ShardPlacement::IN_PROCESS, ShardPlacement::SEPARATE_PROCESS}) {
+#ifdef _WIN32
+            if (placement == ShardPlacement::SEPARATE_PROCESS) {
+                continue;
+            }
+#endif
+            for (const size_t shard_count : {1u, 3u, 8u}) {
+                TestShardedMatchesSingleServer(placement, shard_count);
+            }
+        }
+#ifndef _WIN32
+        // Все дочерние процессы шардов собраны деструкторами.
+        Check(waitpid(-1, nullptr, WNOHANG) < 0, "shard processes are reaped");
+#endif
+        TestFailedBatchIsRolledBack();
+        TestShardFindRejectsNegativeCount();
+    } catch (const exception& e) {
+        cerr << "FAILED: " << e.what() << endl;
+        return 1;
+    }
+    cout << "OK" << endl;
+    return 0;
+}
@@ -0,0 +1,150 @@
+#include "search_server.h"
+#include "snapshot.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+// Проверки не зависят от NDEBUG, поэтому тест работает и в Release-сборке.
+namespace {
+
+void Check(bool condition, string_view message) {
+    if (!condition) {
+        throw runtime_error(string(message));
+    }
+}
+
+// Загрузка должна отвергнуть снимок исключением, в тексте которого есть reason.
+void CheckLoadFails(const string& path, string_view reason, string_view message) {
+    try {
+        SearchServer::LoadSnapshot(path);
+    } catch (const runtime_error& e) {
+        Check(string_view(e.what()).find(reason) != string_view::npos, message);
+        return;
+    }
+    throw runtime_error(string(message));
+}
+
+string ReadFile(const string& path) {
+    ifstream input(path, ios::binary);
+    return string(istreambuf_iterator<char>(input), istreambuf_iterator<char>());
+}
+
+void WriteFile(const string& path, const string& data) {
+    ofstream output(path, ios::binary | ios::trunc);
+    output.write(data.data(), static_cast<streamsize>(data.size()));
+}
+
+SearchServer MakeServer() {
+    SearchServer server("and with in"s);
+    server.AddDocument(1, "funny pet and nasty rat", DocumentStatus::ACTUAL, {7, 2, 7});
+    server.AddDocument(2, "funny pet with curly hair", DocumentStatus::ACTUAL, {1, 2});
+    server.AddDocument(3, "big cat nasty hair", DocumentStatus::BANNED, {-3});
+    server.AddDocument(4, "big dog cat Vladislav", DocumentStatus::IRRELEVANT, {9});
+    server.AddDocument(5, "curly cat curly tail in the garden", DocumentStatus::ACTUAL, {4, 4});
+    server.AddDocument(6, "pet rat white tail", DocumentStatus::REMOVED, {});
+    server.RemoveDocument(2);
+    return server;
+}
+
+void CheckSameServer(const SearchServer& expected, const SearchServer& actual) {
+    Check(vector<int>(actual.begin(), actual.end()) == vector<int>(expected.begin(), expected.end()), "document ids survive snapshot");
+    TopKOptions wand_options;
+    wand_options.mode = TopKMode::WAND;
+    for (const string_view query : {"curly cat"sv, "nasty hair -big"sv, "\"curly tail\" pet"sv, "and tail"sv}) {
+        for (const TopKOptions& options : {TopKOptions{}, wand_options}) {
+            const vector<Document> expected_documents = expected.FindTopDocuments(query, DocumentStatusSet::All(), options);
+            const vector<Document> actual_documents = actual.FindTopDocuments(query, DocumentStatusSet::All(), options);
+            Check(actual_documents.size() == expected_documents.size(), "result size survives snapshot");
+            for (size_t i = 0; i < actual_documents.size(); ++i) {
+                Check(actual_documents[i].id == expected_documents[i].id
+                          && actual_documents[i].relevance == expected_documents[i].relevance
+                          && actual_documents[i].rating == expected_documents[i].rating,
+                      "result documents survive snapshot");
+            }
+        }
+    }
+    for (const int document_id : expected) {
+        Check(actual.MatchDocument("cat and tail pet", document_id) == expected.MatchDocument("cat and tail pet", document_id),
+              "matched words and status survive snapshot");
+        Check(actual.GetWordFrequencies(document_id) == expected.GetWordFrequencies(document_id), "word frequencies survive snapshot");
+    }
+}
+
+void TestRoundTrip(const string& path) {
+    const SearchServer server = MakeServer();
+    server.SaveSnapshot(path);
+    SearchServer loaded = SearchServer::LoadSnapshot(path);
+    CheckSameServer(server, loaded);
+
+    // Загруженный сервер продолжает пополняться наравне с исходным.
+    SearchServer expected = MakeServer();
+    expected.AddDocument(7, "white cat", DocumentStatus::ACTUAL, {5});
+    loaded.AddDocument(7, "white cat", DocumentStatus::ACTUAL, {5});
+    CheckSameServer(expected, loaded);
+
+    // Повторное сохранение заменяет прежний снимок целиком.
+    loaded.SaveSnapshot(path);
+    CheckSameServer(expected, SearchServer::LoadSnapshot(path));
+}
+
+void TestRejectsBrokenSnapshots(const string& path) {
+    MakeServer().SaveSnapshot(path);
+    const string snapshot = ReadFile(path);
+    Check(snapshot.size() > sizeof(SnapshotHeader), "snapshot has a payload");
+
+    string corrupted = snapshot;
+    corrupted[sizeof(SnapshotHeader) + (corrupted.size() - sizeof(SnapshotHeader)) / 2] ^= 0x20;
+    WriteFile(path, corrupted);
+    CheckLoadFails(path, "checksum", "corrupted payload is rejected");
+
+    WriteFile(path, snapshot.substr(0, snapshot.size() - 1));
+    CheckLoadFails(path, "truncated", "truncated snapshot is rejected");
+
+    WriteFile(path, snapshot.substr(0, sizeof(SnapshotHeader) / 2));
+    CheckLoadFails(path, "truncated", "truncated header is rejected");
+
+    string wrong_version = snapshot;
+    const uint32_t next_version = SNAPSHOT_VERSION + 1;
+    wrong_version.replace(offsetof(SnapshotHeader, version), sizeof(next_version), reinterpret_cast<const char*>(&next_version),
+                          sizeof(next_version));
+    WriteFile(path, wrong_version);
+    CheckLoadFails(path, "version", "snapshot of another version is rejected");
+
+    string wrong_magic = snapshot;
+    wrong_magic[0] = 'X';
+    WriteFile(path, wrong_magic);
+    CheckLoadFails(path, "not a search server snapshot", "file without snapshot magic is rejected");
+
+    filesystem::remove(path);
+    CheckLoadFails(path, "cannot open", "missing snapshot is rejected");
+}
+
+}  // namespace
+
+int main() {
+    const string path = (filesystem::temp_directory_path() / ("search_server_snapshot_test_"s + to_string(random_device{}()))).string();
+    int result = 0;
+    try {
+        TestRoundTrip(path);
+        TestRejectsBrokenSnapshots(path);
+    } catch (const exception& e) {
+        cerr << "FAILED: " << e.what() << endl;
+        result = 1;
+    }
+    filesystem::remove(path);
+    if (result == 0) {
+        cout << "OK" << endl;
+    }
+    return result;
+}
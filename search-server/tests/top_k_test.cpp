@@ -0,0 +1,115 @@
+#include "search_server.h"
+
+#include <algorithm>
+#include <execution>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+// Проверки не зависят от NDEBUG, поэтому тест работает и в Release-сборке.
+namespace {
+
+void Check(bool condition, string_view message) {
+    if (!condition) {
+        throw runtime_error(string(message));
+    }
+}
+
+void CheckSameDocuments(const vector<Document>& expected, const vector<Document>& actual, string_view message) {
+    Check(actual.size() == expected.size(), message);
+    for (size_t i = 0; i < actual.size(); ++i) {
+        Check(actual[i].id == expected[i].id && actual[i].relevance == expected[i].relevance
+                  && actual[i].rating == expected[i].rating,
+              message);
+    }
+}
+
+// Частые слова с малыми номерами дают длинные списки вхождений, на которых WAND отсекает документы.
+string MakeText(mt19937& generator, int word_count) {
+    geometric_distribution<int> word(0.15);
+    string text;
+    for (int i = 0; i < word_count; ++i) {
+        text += "w"s + to_string(word(generator)) + ' ';
+    }
+    return text;
+}
+
+SearchServer MakeServer() {
+    mt19937 generator(7);
+    SearchServer server("w0"s);
+    for (int id = 0; id < 2000; ++id) {
+        const DocumentStatus status = id % 5 == 0 ? DocumentStatus::BANNED : DocumentStatus::ACTUAL;
+        server.AddDocument(id, MakeText(generator, 5 + id % 20), status, {id % 7, id % 3});
+    }
+    // Удалённые документы остаются в списках до сжатия, WAND должен их пропускать.
+    for (int id = 0; id < 2000; id += 9) {
+        server.RemoveDocument(id);
+    }
+    return server;
+}
+
+// WAND отбрасывает документы по верхним границам вкладов слов, но выдача должна совпасть
+// с полным перебором бит в бит при любом размере выдачи и модели ранжирования.
+void TestWandMatchesExhaustive(const SearchServer& server) {
+    const vector<string_view> queries = {"w1 w2"sv, "w1 w3 w5 w8"sv, "w2 w4 -w1"sv, "w6 w12 w20 w30"sv, "w1 w2 w3 -w4 -w5"sv};
+    for (const string_view query : queries) {
+        for (const size_t count : {1u, 5u, 50u, 5000u}) {
+            for (const RankingModel ranking : {RankingModel::TF_IDF, RankingModel::BM25}) {
+                for (const DocumentStatusSet statuses : {DocumentStatusSet(DocumentStatus::ACTUAL), DocumentStatusSet::All()}) {
+                    TopKOptions options;
+                    options.count = count;
+                    options.ranking = ranking;
+                    const vector<Document> expected = server.FindTopDocuments(query, statuses, options);
+                    options.mode = TopKMode::WAND;
+                    CheckSameDocuments(expected, server.FindTopDocuments(query, statuses, options), "WAND matches exhaustive");
+                    CheckSameDocuments(expected, server.FindTopDocuments(execution::par, query, statuses, options),
+                                       "parallel WAND matches exhaustive");
+                    const auto is_even = [](int document_id, DocumentStatus, int) {
+                        return document_id % 2 == 0;
+                    };
+                    options.mode = TopKMode::EXHAUSTIVE;
+                    const vector<Document> expected_even = server.FindTopDocuments(query, is_even, options);
+                    options.mode = TopKMode::WAND;
+                    CheckSameDocuments(expected_even, server.FindTopDocuments(query, is_even, options),
+                                       "WAND with predicate matches exhaustive");
+                }
+            }
+        }
+    }
+}
+
+// Ограниченный отбор возвращает начало полной выдачи, упорядоченной CompareDocuments.
+void TestTopKIsPrefixOfFullResult(const SearchServer& server) {
+    TopKOptions all_options;
+    all_options.count = 5000;
+    const vector<Document> all = server.FindTopDocuments("w1 w3 w7"sv, DocumentStatusSet::All(), all_options);
+    Check(all.size() > 100, "query matches many documents");
+    Check(is_sorted(all.begin(), all.end(), CompareDocuments), "full result is ordered");
+    for (const size_t count : {1u, 5u, 17u, 100u}) {
+        TopKOptions options;
+        options.count = count;
+        const vector<Document> top = server.FindTopDocuments("w1 w3 w7"sv, DocumentStatusSet::All(), options);
+        CheckSameDocuments(vector<Document>(all.begin(), all.begin() + count), top, "top-k is a prefix of the full result");
+    }
+    Check(server.FindTopDocuments("w1 w3 w7"sv).size() == MAX_RESULT_DOCUMENT_COUNT, "default count is preserved");
+}
+
+}  // namespace
+
+int main() {
+    try {
+        const SearchServer server = MakeServer();
+        TestWandMatchesExhaustive(server);
+        TestTopKIsPrefixOfFullResult(server);
+    } catch (const exception& e) {
+        cerr << "FAILED: " << e.what() << endl;
+        return 1;
+    }
+    cout << "OK" << endl;
+    return 0;
+}
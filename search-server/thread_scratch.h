@@ -0,0 +1,52 @@
+#pragma once
+
+#include <memory>
+
+// Экземпляр T, принадлежащий потоку и переиспользуемый между вызовами: после первых
+// запросов буферы уже имеют нужную ёмкость, и горячий путь не выделяет память.
+// Если экземпляр потока уже захвачен выше по стеку (например, поиск вызван из предиката
+// другого поиска), выдаётся временный экземпляр.
+template <typename T>
+class ThreadScratch {
+public:
+    ThreadScratch() {
+        if (IsInUse()) {
+            temporary_ = std::make_unique<T>();
+            value_ = temporary_.get();
+        } else {
+            IsInUse() = true;
+            value_ = &GetInstance();
+        }
+    }
+
+    ~ThreadScratch() {
+        if (!temporary_) {
+            IsInUse() = false;
+        }
+    }
+
+    ThreadScratch(const ThreadScratch&) = delete;
+    ThreadScratch& operator=(const ThreadScratch&) = delete;
+
+    T& operator*() const {
+        return *value_;
+    }
+
+    T* operator->() const {
+        return value_;
+    }
+
+private:
+    static T& GetInstance() {
+        thread_local T instance;
+        return instance;
+    }
+
+    static bool& IsInUse() {
+        thread_local bool in_use = false;
+        return in_use;
+    }
+
+    T* value_ = nullptr;
+    std::unique_ptr<T> temporary_;
+};
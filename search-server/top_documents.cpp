@@ -0,0 +1,47 @@
+#include "top_documents.h"
+
+#include <algorithm>
+
+using namespace std;
+
+TopDocumentsCollector::TopDocumentsCollector(size_t capacity, const optional<Document>& after)
+        : capacity_(capacity)
+        , after_(after) {
+}
+
+void TopDocumentsCollector::Add(const Document& document) {
+    if (capacity_ == 0 || (after_ && !CompareDocuments(*after_, document))) {
+        return;
+    }
+    if (heap_.size() < capacity_) {
+        if (heap_.empty()) {
+            // Результат отдаётся вызывающему, поэтому память под него выделяется один раз.
+            heap_.reserve(min(capacity_, MAX_RESERVED_DOCUMENTS));
+        }
+        heap_.push_back(document);
+        push_heap(heap_.begin(), heap_.end(), CompareDocuments);
+    } else if (CompareDocuments(document, heap_.front())) {
+        pop_heap(heap_.begin(), heap_.end(), CompareDocuments);
+        heap_.back() = document;
+        push_heap(heap_.begin(), heap_.end(), CompareDocuments);
+    }
+}
+
+void TopDocumentsCollector::Merge(const vector<Document>& documents) {
+    for (const Document& document : documents) {
+        Add(document);
+    }
+}
+
+bool TopDocumentsCollector::IsFull() const {
+    return capacity_ > 0 && heap_.size() == capacity_;
+}
+
+const Document& TopDocumentsCollector::GetWorst() const {
+    return heap_.front();
+}
+
+vector<Document> TopDocumentsCollector::Extract() {
+    sort_heap(heap_.begin(), heap_.end(), CompareDocuments);
+    return move(heap_);
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "document.h"
+
+#include <cstddef>
+#include <optional>
+#include <vector>
+
+// Ограниченная куча лучших документов: хранит не больше capacity элементов,
+// на вершине находится худший из сохранённых. Если задан after, принимаются только документы,
+// которые в порядке CompareDocuments идут строго после него.
+class TopDocumentsCollector {
+public:
+    explicit TopDocumentsCollector(size_t capacity, const std::optional<Document>& after = std::nullopt);
+
+    void Add(const Document& document);
+    void Merge(const std::vector<Document>& documents);
+
+    bool IsFull() const;
+    // Худший сохранённый документ; имеет смысл только при IsFull().
+    const Document& GetWorst() const;
+
+    // Документы в порядке убывания ранга.
+    std::vector<Document> Extract();
+
+private:
+    static constexpr size_t MAX_RESERVED_DOCUMENTS = 1024;
+
+    size_t capacity_;
+    std::optional<Document> after_;
+    std::vector<Document> heap_;
+};
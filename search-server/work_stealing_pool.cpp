@@ -0,0 +1,150 @@
+#include "work_stealing_pool.h"
+
+#include <algorithm>
+
+using namespace std;
+
+namespace {
+
+// Пул и номер очереди текущего потока, если он принадлежит пулу.
+thread_local const WorkStealingPool* current_pool = nullptr;
+thread_local size_t current_worker = 0;
+
+}  // namespace
+
+WorkStealingPool::WorkStealingPool(size_t thread_count, size_t queue_capacity)
+        : queue_capacity_(queue_capacity) {
+    if (thread_count == 0) {
+        thread_count = max(1u, thread::hardware_concurrency());
+    }
+    for (size_t i = 0; i < thread_count; ++i) {
+        workers_.push_back(make_unique<Worker>());
+    }
+    threads_.reserve(thread_count);
+    for (size_t i = 0; i < thread_count; ++i) {
+        threads_.emplace_back([this, i] {
+            Run(i);
+        });
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        lock_guard lock(mutex_);
+        stopping_ = true;
+    }
+    task_available_.notify_all();
+    for (thread& worker_thread : threads_) {
+        worker_thread.join();
+    }
+}
+
+bool WorkStealingPool::TrySubmit(Task task) {
+    if (!TryReserveExternal()) {
+        return false;
+    }
+    Push({move(task), true});
+    return true;
+}
+
+void WorkStealingPool::Submit(Task task) {
+    while (!TryReserveExternal()) {
+        unique_lock lock(mutex_);
+        ++waiting_submitter_count_;
+        space_available_.wait(lock, [this] {
+            return external_count_ < queue_capacity_;
+        });
+        --waiting_submitter_count_;
+    }
+    Push({move(task), true});
+}
+
+bool WorkStealingPool::TryReserveExternal() {
+    size_t count = external_count_.load();
+    do {
+        if (count >= queue_capacity_) {
+            return false;
+        }
+    } while (!external_count_.compare_exchange_weak(count, count + 1));
+    return true;
+}
+
+size_t WorkStealingPool::GetThreadCount() const {
+    return threads_.size();
+}
+
+size_t WorkStealingPool::GetQueuedTaskCount() const {
+    return external_count_.load();
+}
+
+// Поток пула кладёт задачи в свою очередь, внешние потоки раскладывают их по кругу.
+void WorkStealingPool::Push(QueuedTask task) {
+    const size_t worker_index = current_pool == this ? current_worker
+                                                     : next_worker_.fetch_add(1, memory_order_relaxed) % workers_.size();
+    // Счётчик растёт раньше, чем задача появляется в очереди, чтобы не уйти в минус,
+    // если её сразу заберёт другой поток.
+    ++pending_count_;
+    {
+        Worker& worker = *workers_[worker_index];
+        lock_guard lock(worker.mutex);
+        worker.tasks.push_back(move(task));
+    }
+    if (sleeping_worker_count_ > 0) {
+        // Пустой захват не даёт уведомлению проскочить между проверкой условия и сном.
+        { lock_guard lock(mutex_); }
+        task_available_.notify_one();
+    }
+}
+
+bool WorkStealingPool::TryPop(size_t worker_index, QueuedTask& task) {
+    {
+        Worker& own = *workers_[worker_index];
+        lock_guard lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = move(own.tasks.back());
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+    for (size_t offset = 1; offset < workers_.size(); ++offset) {
+        Worker& victim = *workers_[(worker_index + offset) % workers_.size()];
+        lock_guard lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingPool::Run(size_t worker_index) {
+    current_pool = this;
+    current_worker = worker_index;
+    for (;;) {
+        QueuedTask task;
+        if (TryPop(worker_index, task)) {
+            --pending_count_;
+            if (task.is_external) {
+                --external_count_;
+                if (waiting_submitter_count_ > 0) {
+                    { lock_guard lock(mutex_); }
+                    space_available_.notify_one();
+                }
+            }
+            task.task();
+            continue;
+        }
+        unique_lock lock(mutex_);
+        // Счётчик мог опередить очередь или отстать от другого потока, вынувшего задачу:
+        // тогда цикл просто повторится.
+        ++sleeping_worker_count_;
+        task_available_.wait(lock, [this] {
+            return pending_count_ > 0 || stopping_;
+        });
+        --sleeping_worker_count_;
+        if (pending_count_ == 0 && stopping_) {
+            return;
+        }
+    }
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Пул потоков с очередью на каждый поток. Поток берёт свои задачи с конца очереди,
+// а закончив их, забирает самые старые задачи из начала чужих очередей.
+// Число задач, поставленных извне, ограничено queue_capacity: TrySubmit при переполнении
+// отказывает, Submit ждёт места. Задачи не должны бросать исключений. Деструктор выполняет
+// оставшиеся задачи и ждёт потоки.
+class WorkStealingPool {
+public:
+    using Task = std::function<void()>;
+
+    // thread_count = 0 означает по потоку на ядро.
+    explicit WorkStealingPool(size_t thread_count = 0, size_t queue_capacity = 1024);
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    bool TrySubmit(Task task);
+    // Из задач самого пула не вызывается: при полной очереди поток ждал бы сам себя.
+    void Submit(Task task);
+
+    // Вызывает job(i) для i из [0, count) силами вызывающего потока и свободных потоков пула
+    // и возвращается, когда все вызовы завершены. job не бросает исключений. Вспомогательные
+    // задачи не учитываются в queue_capacity, поэтому ParallelFor можно звать из задач пула.
+    template <typename Job>
+    void ParallelFor(size_t count, const Job& job);
+
+    size_t GetThreadCount() const;
+    // Число ещё не начатых задач, поставленных через Submit и TrySubmit.
+    size_t GetQueuedTaskCount() const;
+
+private:
+    struct QueuedTask {
+        Task task;
+        bool is_external;
+    };
+
+    struct Worker {
+        std::mutex mutex;
+        std::deque<QueuedTask> tasks;
+    };
+
+    void Push(QueuedTask task);
+    bool TryPop(size_t worker_index, QueuedTask& task);
+    // Занимает место для внешней задачи, если queue_capacity ещё не исчерпана.
+    bool TryReserveExternal();
+    void Run(size_t worker_index);
+
+    const size_t queue_capacity_;
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::vector<std::thread> threads_;
+    std::atomic<size_t> next_worker_{0};
+
+    // Счётчики меняются без блокировки. mutex_ берётся только тем, кто засыпает, и тем,
+    // кто будит, когда счётчик ожидающих ненулевой: ожидающий увеличивает свой счётчик и
+    // затем проверяет условие, будящий меняет условие и затем читает счётчик, поэтому
+    // при последовательно согласованных атомиках хотя бы один из них видит другого.
+    std::atomic<size_t> pending_count_{0};
+    std::atomic<size_t> external_count_{0};
+    std::atomic<size_t> sleeping_worker_count_{0};
+    std::atomic<size_t> waiting_submitter_count_{0};
+    std::mutex mutex_;
+    std::condition_variable task_available_;
+    std::condition_variable space_available_;
+    bool stopping_ = false;
+};
+
+template <typename Job>
+void WorkStealingPool::ParallelFor(size_t count, const Job& job) {
+    struct State {
+        std::atomic<size_t> next{0};
+        std::atomic<size_t> done{0};
+        std::mutex mutex;
+        std::condition_variable finished;
+    };
+    // Помощник может начаться уже после возврата из ParallelFor: он увидит исчерпанный
+    // счётчик и не обратится к job, а общее состояние держит через shared_ptr.
+    const auto state = std::make_shared<State>();
+    const auto run = [state, &job, count] {
+        for (size_t i = state->next.fetch_add(1); i < count; i = state->next.fetch_add(1)) {
+            job(i);
+            if (state->done.fetch_add(1) + 1 == count) {
+                std::lock_guard lock(state->mutex);
+                state->finished.notify_all();
+            }
+        }
+    };
+    const size_t helper_count = std::min(count, workers_.size() + 1) - (count > 0 ? 1 : 0);
+    for (size_t i = 0; i < helper_count; ++i) {
+        Push({run, false});
+    }
+    run();
+    std::unique_lock lock(state->mutex);
+    state->finished.wait(lock, [&state, count] {
+        return state->done.load() == count;
+    });
+}